@@ -0,0 +1,137 @@
+// license:BSD-3-Clause
+// copyright-holders:Ariane Fugmann
+/***************************************************************************
+
+    Minimal Arduino/AVR environment for building C139.ino on a host
+
+    Only what the sketch uses: byte, String, Serial on stdin/stdout, the
+    delay functions and the ATmega2560 port registers. Port accesses are
+    routed to avr_ports.cpp, which turns the bit-banged bus into register
+    and ram accesses on an emulated C139 (see c139_bus.h).
+
+***************************************************************************/
+#ifndef C139_HOST_ARDUINO_H
+#define C139_HOST_ARDUINO_H
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+
+typedef uint8_t byte;
+
+#define LOW  0
+#define HIGH 1
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+
+//**************************************************************************
+//  STRING
+//**************************************************************************
+
+class String
+{
+public:
+	String() { }
+	String(const char *str) : m_str(str) { }
+	String(const std::string &str) : m_str(str) { }
+
+	unsigned length() const { return m_str.length(); }
+	int indexOf(char c) const { size_t const pos = m_str.find(c); return (pos == std::string::npos) ? -1 : int(pos); }
+	String substring(unsigned from) const { return String(m_str.substr(std::min<size_t>(from, m_str.length()))); }
+	String substring(unsigned from, unsigned to) const { return String(m_str.substr(from, to - from)); }
+	void toCharArray(char *buf, unsigned size) const { if (size) { std::strncpy(buf, m_str.c_str(), size - 1); buf[size - 1] = 0; } }
+	const char *c_str() const { return m_str.c_str(); }
+
+	bool operator==(const char *str) const { return m_str == str; }
+	bool operator==(const String &str) const { return m_str == str.m_str; }
+
+private:
+	std::string m_str;
+};
+
+
+//**************************************************************************
+//  SERIAL
+//**************************************************************************
+
+class host_serial
+{
+public:
+	void begin(unsigned long) { }
+
+	size_t readBytesUntil(char terminator, char *buffer, size_t length);
+
+	void print(const char *str) { std::fputs(str, stdout); }
+	void print(const String &str) { std::fputs(str.c_str(), stdout); }
+	void print(long value) { std::printf("%ld", value); }
+	void println() { std::fputc('\n', stdout); std::fflush(stdout); }
+	template <typename T> void println(T value) { print(value); println(); }
+
+	// set once stdin is exhausted, the host main loop stops then
+	bool eof() const { return m_eof; }
+
+private:
+	bool m_eof = false;
+};
+
+extern host_serial Serial;
+
+
+//**************************************************************************
+//  AVR PORTS
+//**************************************************************************
+
+enum class avr_port : uint8_t { A, C, F, H, K, L };
+
+uint8_t avr_read_pin(avr_port port);
+uint8_t avr_read_port(avr_port port);
+void avr_write_port(avr_port port, uint8_t data);
+uint8_t avr_read_ddr(avr_port port);
+void avr_write_ddr(avr_port port, uint8_t data);
+
+// PORTx and DDRx as assignable registers, one instance shared by every file
+template <avr_port Port>
+struct avr_port_reg
+{
+	operator uint8_t() const { return avr_read_port(Port); }
+	avr_port_reg &operator=(uint8_t data) { avr_write_port(Port, data); return *this; }
+};
+
+template <avr_port Port>
+struct avr_ddr_reg
+{
+	operator uint8_t() const { return avr_read_ddr(Port); }
+	avr_ddr_reg &operator=(uint8_t data) { avr_write_ddr(Port, data); return *this; }
+};
+
+#define AVR_PORT(x) \
+	inline avr_port_reg<avr_port::x> PORT##x; \
+	inline avr_ddr_reg<avr_port::x> DDR##x;
+
+AVR_PORT(A)
+AVR_PORT(C)
+AVR_PORT(F)
+AVR_PORT(H)
+AVR_PORT(K)
+AVR_PORT(L)
+
+#undef AVR_PORT
+
+// PINx are plain values so they can be passed to sprintf
+#define PINA avr_read_pin(avr_port::A)
+#define PINC avr_read_pin(avr_port::C)
+#define PINF avr_read_pin(avr_port::F)
+#define PINH avr_read_pin(avr_port::H)
+#define PINK avr_read_pin(avr_port::K)
+#define PINL avr_read_pin(avr_port::L)
+
+#endif // C139_HOST_ARDUINO_H
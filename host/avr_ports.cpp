@@ -0,0 +1,214 @@
+// license:BSD-3-Clause
+// copyright-holders:Ariane Fugmann
+/***************************************************************************
+
+    ATmega2560 port shim for the host build of C139.ino
+
+    Follows the sketch's wiring (see the top of C139.ino):
+
+    PORTF/PORTK     address 00-07 / 08-15, outputs
+    PORTA/PORTC     data 00-07 / 08-15, bidirectional
+    PORTL           CS-, R+W-, RES-, IRQ- (in), DTACK- (in), DT-, 12MHz, 16MHz
+    PORTH           RINGI (out), RINGO (in)
+
+    Every rising edge on the 12MHz line is one emulated clock. A falling
+    CS- runs the access on the emulated chip, DT- low selecting the
+    registers, and DTACK- follows one clock later like on the real part.
+    RINGO stays idle high: the emulation moves whole frames, not bits.
+
+    The sketch reads PINL on every clock edge, far too often for a socket
+    round trip each. Clocks are counted here and only sent to the emulator
+    before a bus cycle, on reset and every IRQ_SYNC_TICKS clocks; IRQ- in
+    between comes from the last reply, so an interrupt can show up that
+    many clocks late. Bus cycles and DTACK- keep their exact timing.
+
+***************************************************************************/
+
+#include "Arduino.h"
+#include "c139_bus.h"
+
+#include <chrono>
+#include <thread>
+
+
+namespace {
+
+constexpr uint8_t CTRL_CS = 0x01;
+constexpr uint8_t CTRL_RW = 0x02;
+constexpr uint8_t CTRL_RES = 0x04;
+constexpr uint8_t CTRL_IRQ = 0x08;
+constexpr uint8_t CTRL_DTACK = 0x10;
+constexpr uint8_t CTRL_DT = 0x20;
+constexpr uint8_t CTRL_12MHz = 0x40;
+constexpr uint8_t AUX_TX = 0x10;
+
+constexpr unsigned DTACK_DELAY = 1;     // 12MHz clocks from CS- to DTACK-
+constexpr unsigned IRQ_SYNC_TICKS = 1200;   // 12MHz clocks between syncs without a bus cycle, 100usec
+
+struct port_state
+{
+	uint8_t port = 0;
+	uint8_t ddr = 0;
+};
+
+port_state g_ports[6];
+unsigned g_ticks_pending = 0;
+unsigned g_dtack_delay = 0;
+bool g_access = false;
+bool g_dtack = false;
+uint16_t g_read_data = 0;
+
+port_state &state(avr_port port) { return g_ports[unsigned(port)]; }
+
+void flush_ticks()
+{
+	if (g_ticks_pending)
+	{
+		g_c139_bus.tick(g_ticks_pending);
+		g_ticks_pending = 0;
+	}
+}
+
+void control_write(uint8_t old, uint8_t data)
+{
+	if ((data & CTRL_12MHz) && !(old & CTRL_12MHz))
+	{
+		g_ticks_pending++;
+		if (g_access && !g_dtack && --g_dtack_delay == 0)
+			g_dtack = true;
+		if (g_ticks_pending >= IRQ_SYNC_TICKS)
+			flush_ticks();
+	}
+
+	if ((data ^ old) & CTRL_RES)
+	{
+		flush_ticks();
+		g_c139_bus.reset_line(!(data & CTRL_RES));
+	}
+
+	if (!(data & CTRL_CS) && (old & CTRL_CS))
+	{
+		// bus cycle starts, the chip sees it from the next clock on
+		flush_ticks();
+		uint16_t const addr = (state(avr_port::K).port << 8) | state(avr_port::F).port;
+		bool const reg = !(data & CTRL_DT);
+		if (data & CTRL_RW)
+		{
+			g_read_data = g_c139_bus.read(reg, addr);
+		}
+		else
+		{
+			uint16_t const value = (state(avr_port::C).port << 8) | state(avr_port::A).port;
+			g_c139_bus.write(reg, addr, value);
+			g_read_data = value;
+		}
+		g_access = true;
+		g_dtack = false;
+		g_dtack_delay = DTACK_DELAY;
+	}
+	else if ((data & CTRL_CS) && !(old & CTRL_CS))
+	{
+		g_access = false;
+		g_dtack = false;
+	}
+}
+
+} // anonymous namespace
+
+
+uint8_t avr_read_port(avr_port port)
+{
+	return state(port).port;
+}
+
+void avr_write_port(avr_port port, uint8_t data)
+{
+	uint8_t const old = state(port).port;
+	state(port).port = data;
+	if (port == avr_port::L)
+		control_write(old, data);
+}
+
+uint8_t avr_read_ddr(avr_port port)
+{
+	return state(port).ddr;
+}
+
+void avr_write_ddr(avr_port port, uint8_t data)
+{
+	state(port).ddr = data;
+}
+
+uint8_t avr_read_pin(avr_port port)
+{
+	port_state const &s = state(port);
+	switch (port)
+	{
+		case avr_port::A:
+		case avr_port::C:
+		{
+			// the chip drives the data bus during a read cycle
+			uint8_t const chip = (port == avr_port::A) ? (g_read_data & 0xff) : (g_read_data >> 8);
+			bool const reading = g_access && (state(avr_port::L).port & CTRL_RW);
+			uint8_t const input = reading ? chip : s.port;
+			return (s.port & s.ddr) | (input & ~s.ddr);
+		}
+
+		case avr_port::L:
+		{
+			// irq as of the last request, see above
+			uint8_t input = 0xff;
+			if (g_c139_bus.irq())
+				input &= ~CTRL_IRQ;
+			if (g_dtack)
+				input &= ~CTRL_DTACK;
+			return (s.port & s.ddr) | (input & ~s.ddr);
+		}
+
+		case avr_port::H:
+			return (s.port & s.ddr) | (AUX_TX & ~s.ddr);
+
+		default:
+			return s.port;
+	}
+}
+
+
+//**************************************************************************
+//  ARDUINO RUNTIME
+//**************************************************************************
+
+host_serial Serial;
+
+size_t host_serial::readBytesUntil(char terminator, char *buffer, size_t length)
+{
+	size_t count = 0;
+	while (count < length)
+	{
+		int const c = std::getchar();
+		if (c == EOF)
+		{
+			m_eof = true;
+			break;
+		}
+		if (c == terminator)
+			break;
+		if (c != '\r')
+			buffer[count++] = char(c);
+	}
+	return count;
+}
+
+void delay(unsigned long ms)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int)
+{
+	// bus timing comes from the clock edges, not from wall time
+}
+
+void digitalWrite(uint8_t, uint8_t)
+{
+}
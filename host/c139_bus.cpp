@@ -0,0 +1,127 @@
+// license:BSD-3-Clause
+// copyright-holders:Ariane Fugmann
+/***************************************************************************
+
+    Bus bridge from the host build of C139.ino to an emulated C139
+
+***************************************************************************/
+
+#include "c139_bus.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+c139_bus g_c139_bus;
+
+
+c139_bus::~c139_bus()
+{
+	if (m_socket >= 0)
+		close(m_socket);
+}
+
+bool c139_bus::connect(const std::string &host, const std::string &port)
+{
+	addrinfo hints = { };
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	addrinfo *result = nullptr;
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0)
+	{
+		std::fprintf(stderr, "c139host: cannot resolve %s:%s\n", host.c_str(), port.c_str());
+		return false;
+	}
+
+	for (addrinfo *ai = result; ai; ai = ai->ai_next)
+	{
+		m_socket = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (m_socket < 0)
+			continue;
+		if (::connect(m_socket, ai->ai_addr, ai->ai_addrlen) == 0)
+			break;
+		close(m_socket);
+		m_socket = -1;
+	}
+	freeaddrinfo(result);
+
+	if (m_socket < 0)
+	{
+		std::fprintf(stderr, "c139host: cannot connect to %s:%s\n", host.c_str(), port.c_str());
+		return false;
+	}
+
+	// every request is a round trip, don't let nagle batch them
+	int const one = 1;
+	setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return true;
+}
+
+uint16_t c139_bus::request(const char *line)
+{
+	if (m_socket < 0)
+		return 0;
+
+	size_t const length = std::strlen(line);
+	if (send(m_socket, line, length, 0) != ssize_t(length))
+	{
+		std::fprintf(stderr, "c139host: connection to the emulator lost\n");
+		std::exit(1);
+	}
+
+	// answer: "<data> <irq>\n"
+	size_t end;
+	while ((end = m_pending.find('\n')) == std::string::npos)
+	{
+		char buffer[256];
+		ssize_t const received = recv(m_socket, buffer, sizeof(buffer), 0);
+		if (received <= 0)
+		{
+			std::fprintf(stderr, "c139host: connection to the emulator lost\n");
+			std::exit(1);
+		}
+		m_pending.append(buffer, received);
+	}
+
+	unsigned data = 0, irq = 0;
+	std::sscanf(m_pending.c_str(), "%x %u", &data, &irq);
+	m_pending.erase(0, end + 1);
+	m_irq = irq != 0;
+	return data;
+}
+
+uint16_t c139_bus::read(bool reg, uint16_t addr)
+{
+	char line[32];
+	std::snprintf(line, sizeof(line), "R %u %x\n", reg ? 1 : 0, addr);
+	return request(line);
+}
+
+void c139_bus::write(bool reg, uint16_t addr, uint16_t data)
+{
+	char line[32];
+	std::snprintf(line, sizeof(line), "W %u %x %x\n", reg ? 1 : 0, addr, data);
+	request(line);
+}
+
+void c139_bus::tick(unsigned ticks)
+{
+	char line[32];
+	std::snprintf(line, sizeof(line), "T %u\n", ticks);
+	request(line);
+}
+
+void c139_bus::reset_line(bool asserted)
+{
+	char line[32];
+	std::snprintf(line, sizeof(line), "X %u\n", asserted ? 0 : 1);
+	request(line);
+}
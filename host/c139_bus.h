@@ -0,0 +1,54 @@
+// license:BSD-3-Clause
+// copyright-holders:Ariane Fugmann
+/***************************************************************************
+
+    Bus bridge from the host build of C139.ino to an emulated C139
+
+    Talks to the c139bbus bench machine (new_c139/c139bench.cpp) over TCP,
+    one request per line, each answered with "<data> <irq>":
+
+    R <dt> <addr>           read, dt = 1 for registers
+    W <dt> <addr> <data>    write
+    T <ticks>               advance emulated time by 12MHz ticks
+    X <res>                 reset line, 0 = asserted
+
+    The emulation only moves forward on T, so both sides stay in lockstep.
+    T is batched by the port shim (avr_ports.cpp), which answers irq polls
+    from the last reply in between.
+
+***************************************************************************/
+#ifndef C139_HOST_C139_BUS_H
+#define C139_HOST_C139_BUS_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+
+class c139_bus
+{
+public:
+	c139_bus() { }
+	~c139_bus();
+
+	bool connect(const std::string &host, const std::string &port);
+
+	uint16_t read(bool reg, uint16_t addr);
+	void write(bool reg, uint16_t addr, uint16_t data);
+	void tick(unsigned ticks);
+	void reset_line(bool asserted);
+
+	bool irq() const { return m_irq; }
+
+private:
+	uint16_t request(const char *line);
+
+	int m_socket = -1;
+	bool m_irq = false;
+	std::string m_pending;
+};
+
+extern c139_bus g_c139_bus;
+
+#endif // C139_HOST_C139_BUS_H
@@ -0,0 +1,71 @@
+// license:BSD-3-Clause
+// copyright-holders:Ariane Fugmann
+/***************************************************************************
+
+    Host build of C139.ino
+
+    Runs the Arduino sketch unchanged against an emulated C139 instead of
+    the real chip, so memtest, testmode, finallap, suzuka8h, ridgera2 and
+    friends produce comparable logs for both.
+
+    g++ -std=c++17 -O2 -Ihost host/main.cpp host/avr_ports.cpp host/c139_bus.cpp -o c139host
+    mame c139bbus -video none &
+    echo memtest | ./c139host [host [port]]
+
+    Commands are read from stdin exactly like from the serial monitor; the
+    program exits at end of input.
+
+***************************************************************************/
+
+#include "Arduino.h"
+#include "c139_bus.h"
+
+
+// the Arduino IDE generates these from the sketch
+void setupPins();
+void setupSerial();
+void split();
+short fromHex(String str);
+void util_reset();
+void util_idle();
+void util_memtest();
+void util_dump(short offs);
+void util_rdump();
+void util_recv(short data, short data2);
+void util_send_84(short data, short data2, short data3, short data4);
+void util_send_d(short data);
+void util_send_d2(short data, short data2);
+void util_finallap();
+void util_suzuka8h();
+void util_ridgera2();
+void util_testmode(short mode, short txsize, short rxsize);
+void tx_test(byte l, byte h);
+void tx_add(short state);
+void c139_memclear();
+void c139_reset();
+void c139_idle();
+void c139_sync16();
+void c139_sync12();
+void c139_tick_x(short x);
+void c139_tick();
+void c139_test();
+short c139_memr(short addr);
+void c139_memw(short addr, short data);
+short c139_regr(short addr);
+void c139_regw(short addr, short data);
+
+#include "../C139.ino"
+
+
+int main(int argc, char *argv[])
+{
+	char const *const host = (argc > 1) ? argv[1] : "127.0.0.1";
+	char const *const port = (argc > 2) ? argv[2] : "15139";
+	if (!g_c139_bus.connect(host, port))
+		return 1;
+
+	setup();
+	while (!Serial.eof())
+		loop();
+	return 0;
+}
@@ -0,0 +1,811 @@
+// license:BSD-3-Clause
+// copyright-holders:Ariane Fugmann
+/***************************************************************************
+
+    Namco C139 link benchmark
+
+    Three C139s wired into the sci_de_hack loopback ring, with no CPUs and
+    no ROMs. A scripted host drives reg_w/ram_w at 60Hz the way the traced
+    games do (see notes/namco_c139.txt) and acknowledges the interrupts.
+
+    c139b08     mode 08 (ridgera2, raverace)
+    c139b09     mode 09 (acedrive, suzuka8h, winrungp)
+    c139b0c     mode 0c (ridgeracf)
+    c139b0d     mode 0d (finallap)
+    c139bscn    plays c139bench.scn from the working directory, as written
+                by tools/c139import.cpp from captured watchpoint logs; a
+                missing, bad or empty file is a fatal error
+    c139bbus    puts node 0 on a TCP port (15139) for the host build of
+                C139.ino (host/), see below
+
+    Run with -bench <seconds>. On exit it prints emulated seconds per
+    second, wall time per 12MHz comm tick, frames per second and the link
+    latency collected by the devices.
+
+    The host only uses the public interface both implementations share, so
+    the same driver also builds against old_c139/ (define C139_OLD and put
+    old_c139/ first on the include path). With "Trace" enabled in the
+    machine configuration menu every run writes c139bench_<impl>_<mode>.log
+    holding irq edges, ram hashes and the rx area after every interrupt;
+    tools/c139diff.cpp compares two of these logs. The ring runs over
+    sockets, so when a frame lands is up to the network thread. To keep
+    the ram hashes comparable, a traced run holds every host each
+    SETTLE_PERIOD frames until the link has gone quiet and only hashes the
+    ram then, when no arrival is left to move.
+
+    c139bbus waits for one connection and then serves a line protocol,
+    each request answered with "<data> <irq>":
+
+    R <dt> <addr>           read, dt = 1 for registers
+    W <dt> <addr> <data>    write
+    T <ticks>               advance emulated time by 12MHz ticks
+    X <res>                 reset line, 0 = asserted
+
+    The machine blocks while waiting for the next request, so emulated time
+    only moves on T and the sketch sees the same clock counts as on the
+    real chip. The interrupt is left to the host to acknowledge. The
+    machine exits when the host disconnects.
+
+***************************************************************************/
+
+#include "emu.h"
+#include "namco_c139.h"
+
+#include "asio.h"
+
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+
+namespace {
+
+class c139bench_state : public driver_device
+{
+public:
+	c139bench_state(const machine_config &mconfig, device_type type, const char *tag) :
+		driver_device(mconfig, type, tag),
+		m_sci(*this, "sci%u", 0U),
+		m_config(*this, "CONFIG"),
+		m_bus_socket(m_bus_ioctx)
+	{ }
+
+	void bench08(machine_config &config) { bench(config, 0x08); }
+	void bench09(machine_config &config) { bench(config, 0x09); }
+	void bench0c(machine_config &config) { bench(config, 0x0c); }
+	void bench0d(machine_config &config) { bench(config, 0x0d); }
+	void benchscn(machine_config &config) { bench(config, MODE_SCENARIO); }
+	void benchbus(machine_config &config) { bench(config, MODE_BUS); }
+
+protected:
+	virtual void machine_start() override ATTR_COLD;
+	virtual void machine_reset() override ATTR_COLD;
+
+private:
+	static constexpr unsigned NODES = 3;
+	static constexpr unsigned TX_WORDS = 0x14;      // finallap txwords
+	static constexpr unsigned RX_WORDS = 0xec;      // finallap expects this many rxwords
+	static constexpr uint8_t MODE_SCENARIO = 0xff;
+	static constexpr uint8_t MODE_BUS = 0xfe;
+	static constexpr unsigned short BUS_PORT = 15139;
+	static constexpr uint32_t SETTLE_PERIOD = 60;   // host frames between ram hashes when tracing
+	static constexpr unsigned SETTLE_QUIET = 2;     // held frames without an irq before the link counts as idle
+
+	// one line of a scenario file
+	struct scenario_step
+	{
+		std::string op;                 // w, r, m, wait, irq, frame, section
+		bool expect = false;
+		unsigned target = 0;            // register, ram offset or wait ticks
+		std::vector<uint16_t> data;
+		std::string name;
+	};
+
+	void bench(machine_config &config, uint8_t mode);
+
+	template <unsigned N> void irq_w(int state);
+	TIMER_CALLBACK_MEMBER(host_frame);
+
+	TIMER_CALLBACK_MEMBER(scenario_step_cb);
+	TIMER_CALLBACK_MEMBER(bus_step);
+
+	bool bus_accept();
+	bool bus_reply(uint16_t data);
+
+	bool scenario_load(const char *path);
+	void scenario_mismatch(unsigned node, const char *what, unsigned offset, uint16_t actual, uint16_t expected);
+	void host_init(unsigned node);
+	void host_tx(unsigned node);
+	void write_payload(unsigned node, unsigned offset, unsigned words, bool sync);
+	uint32_t ram_hash(unsigned node, unsigned start, unsigned end);
+	bool link_settled();
+	uint64_t now_ticks() { return machine().time().as_ticks(12'000'000); }
+	void report();
+
+	required_device_array<namco_c139_device, NODES> m_sci;
+	required_ioport m_config;
+
+	emu_timer *m_host_timer = nullptr;
+	emu_timer *m_scenario_timer = nullptr;
+	std::vector<scenario_step> m_scenario;
+	unsigned m_scenario_pos = 0;
+	std::string m_scenario_section;
+	uint64_t m_scenario_irqs[NODES];
+	unsigned m_mismatches = 0;
+	uint8_t m_mode = 0;
+	uint32_t m_frame = 0;
+	uint64_t m_irqs[NODES];
+	uint64_t m_stalls[NODES];
+	unsigned m_quiet_frames = 0;
+	osd_ticks_t m_last_irq_ticks = 0;
+	osd_ticks_t m_hold_ticks = 0;
+	osd_ticks_t m_start_ticks = 0;
+	std::clock_t m_start_clock = 0;
+	std::ofstream m_trace;
+
+	asio::io_context m_bus_ioctx;
+	asio::ip::tcp::socket m_bus_socket;
+	std::string m_bus_pending;
+	emu_timer *m_bus_timer = nullptr;
+	bool m_bus_irq = false;
+};
+
+
+#ifdef C139_OLD
+static constexpr char IMPL_NAME[] = "old";
+#else
+static constexpr char IMPL_NAME[] = "new";
+#endif
+
+
+INPUT_PORTS_START( c139bench )
+	PORT_START("CONFIG")
+	PORT_CONFNAME( 0x01, 0x00, "Trace" )
+	PORT_CONFSETTING(    0x00, DEF_STR( Off ) )
+	PORT_CONFSETTING(    0x01, DEF_STR( On ) )
+INPUT_PORTS_END
+
+
+//-------------------------------------------------
+//  scripted host
+//-------------------------------------------------
+
+uint32_t c139bench_state::ram_hash(unsigned node, unsigned start, unsigned end)
+{
+	// fnv-1a over the 9-bit words
+	uint32_t hash = 0x811c9dc5;
+	for (unsigned offset = start; offset < end; offset++)
+	{
+		uint16_t const data = m_sci[node]->ram_r(offset);
+		hash = (hash ^ (data & 0xff)) * 0x01000193;
+		hash = (hash ^ (data >> 8)) * 0x01000193;
+	}
+	return hash;
+}
+
+void c139bench_state::write_payload(unsigned node, unsigned offset, unsigned words, bool sync)
+{
+	// slowly changing counters, roughly what a car position update looks like
+	for (unsigned i = 0; i < words; i++)
+	{
+		uint16_t data = ((m_frame >> (i & 3)) + (i * 7) + node) & 0xff;
+		if (sync && i == words - 1)
+			data |= 0x100;
+		m_sci[node]->ram_w(offset + i, data);
+	}
+}
+
+void c139bench_state::host_init(unsigned node)
+{
+	namco_c139_device &sci = *m_sci[node];
+
+	switch (m_mode)
+	{
+		case 0x08:
+			// ridgera2
+			sci.reg_w(0, 0x0000);
+			sci.reg_w(1, 0x000f);
+			sci.reg_w(2, 0x0000);
+			sci.reg_w(3, 0x0011);
+			sci.reg_w(4, 0x0004);
+			sci.reg_w(5, 0x0004);
+			sci.reg_w(6, 0x0000);
+			sci.reg_w(7, 0x0000);
+
+			// let the init frame go out so tx-empty comes up
+			sci.reg_w(3, 0x0000);
+			break;
+
+		case 0x09:
+			// acedrive
+			sci.reg_w(0, 0x0000);
+			sci.reg_w(1, 0x000f);
+			sci.reg_w(2, 0x0000);
+			sci.reg_w(3, 0x0003);
+			sci.reg_w(4, 0x0000);
+			sci.reg_w(5, 0x0000);
+			sci.reg_w(6, 0x1000);
+			sci.reg_w(7, 0x1000);
+			break;
+
+		case 0x0c:
+			// ridgeracf
+			sci.reg_w(0, 0x0000);
+			sci.reg_w(1, 0x000f);
+			sci.reg_w(2, 0x0000);
+			sci.reg_w(3, 0x0001);
+			sci.reg_w(4, 0x0004);
+			sci.reg_w(5, 0x0004);
+			sci.reg_w(6, 0x0000);
+			sci.reg_w(7, 0x0000);
+
+			sci.reg_w(0, 0x0000);
+			sci.reg_w(1, 0x000c);
+			sci.reg_w(2, 0x0000);
+			sci.reg_w(3, 0x0001);
+			sci.reg_w(4, 0x0000);
+			sci.reg_w(5, 0x0000);
+			sci.reg_w(6, 0x0000);
+			sci.reg_w(7, 0x1000);
+			break;
+
+		case 0x0d:
+			// finallap
+			sci.reg_w(0, 0x0000);
+			sci.reg_w(3, 0x0000);
+			sci.reg_w(4, 0x0000);
+			sci.reg_w(5, 0x0000);
+			sci.reg_w(6, 0x0000);
+			sci.reg_w(7, 0x0000);
+			sci.reg_w(3, 0x0000);
+			sci.reg_w(1, 0x000d);
+			break;
+	}
+}
+
+void c139bench_state::host_tx(unsigned node)
+{
+	namco_c139_device &sci = *m_sci[node];
+
+	// games poll tx-empty before queueing the next update
+	if (!(sci.reg_r(0) & 0x04))
+	{
+		m_stalls[node]++;
+		return;
+	}
+
+	switch (m_mode)
+	{
+		case 0x08:
+			write_payload(node, 0x0000, 0x28, true);
+			sci.reg_w(2, 0x0001);
+			sci.reg_w(2, 0x0003);
+			sci.reg_w(5, 0x0028);
+			sci.reg_w(1, 0x0008);
+			break;
+
+		case 0x09:
+			// one 0x100 word slot per node, sync bit marks the end
+			sci.reg_w(3, 0x0003);
+			write_payload(node, 0x1000 + (node * 0x100), 0x100, true);
+			sci.reg_w(6, 0x1000);
+			sci.reg_w(7, 0x1000 + (node * 0x100));
+			sci.reg_w(3, 0x0000);
+			sci.reg_w(5, 0x00ff);
+			sci.reg_w(1, 0x0009);
+			break;
+
+		case 0x0c:
+			sci.reg_w(7, 0x0000);
+			sci.reg_w(2, 0x0001);
+			sci.reg_w(2, 0x0003);
+			sci.reg_w(3, 0x0001);
+			write_payload(node, 0x0000, 0xf2, false);
+			sci.reg_w(5, 0x00f2);
+			sci.reg_w(1, 0x000c);
+			sci.reg_w(3, 0x0000);
+			break;
+
+		case 0x0d:
+			write_payload(node, 0x0000, TX_WORDS, false);
+			sci.reg_w(4, RX_WORDS);
+			sci.reg_w(6, 0x0000);
+			sci.reg_w(7, 0x0000);
+			sci.reg_w(5, TX_WORDS);
+			sci.reg_w(1, 0x000d);
+			break;
+	}
+}
+
+template <unsigned N>
+void c139bench_state::irq_w(int state)
+{
+	if (m_trace.is_open())
+		m_trace << util::string_format("I %u %u %d\n", N, now_ticks(), state);
+
+	if (N == 0 && m_mode == MODE_BUS)
+		m_bus_irq = state;
+
+	if (!state)
+		return;
+
+	m_quiet_frames = 0;
+	m_last_irq_ticks = osd_ticks();
+
+	// what arrived over the wire ends up in the rx area
+	if (m_trace.is_open())
+		m_trace << util::string_format("X %u %u %08x %04x\n", N, now_ticks(), ram_hash(N, 0x1000, 0x2000), m_sci[N]->reg_r(6));
+
+	// acknowledge like the game irq handlers do, unless the bus host does it
+	m_irqs[N]++;
+	if (N != 0 || m_mode != MODE_BUS)
+		m_sci[N]->reg_w(0, 0x0000);
+}
+
+bool c139bench_state::link_settled()
+{
+	// the sockets run on wall time and a free running bench can pass many
+	// frames in a millisecond, so wait out both clocks
+	if (m_quiet_frames < SETTLE_QUIET)
+		return false;
+	if (osd_ticks() - m_last_irq_ticks < osd_ticks_per_second() / 50)
+		return false;
+
+	for (unsigned node = 0; node < NODES; node++)
+	{
+		if (!(m_sci[node]->reg_r(0) & 0x04))
+			return false;
+	}
+	return true;
+}
+
+TIMER_CALLBACK_MEMBER(c139bench_state::host_frame)
+{
+	if (m_trace.is_open() && m_frame && !(m_frame % SETTLE_PERIOD))
+	{
+		// hold the hosts until nothing is left in flight, so the hashes
+		// don't depend on when the network thread delivered each frame
+		if (!m_hold_ticks)
+		{
+			m_hold_ticks = osd_ticks();
+			m_quiet_frames = 0;
+		}
+		m_quiet_frames++;
+
+		bool const settled = link_settled();
+		if (!settled && osd_ticks() - m_hold_ticks < osd_ticks_per_second())
+			return;
+
+		// a link that never goes quiet is logged as such and counts as a difference
+		for (unsigned node = 0; node < NODES; node++)
+		{
+			if (settled)
+				m_trace << util::string_format("R %u %u %08x %04x\n", node, m_frame, ram_hash(node, 0x0000, 0x2000), m_sci[node]->reg_r(0));
+			else
+				m_trace << util::string_format("R %u %u unsettled %04x\n", node, m_frame, m_sci[node]->reg_r(0));
+		}
+		m_hold_ticks = 0;
+	}
+
+	for (unsigned node = 0; node < NODES; node++)
+		host_tx(node);
+	m_frame++;
+}
+
+
+//-------------------------------------------------
+//  scenario playback
+//-------------------------------------------------
+
+bool c139bench_state::scenario_load(const char *path)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		osd_printf_error("C139 bench: cannot open scenario %s\n", path);
+		return false;
+	}
+
+	std::string line;
+	unsigned lineno = 0;
+	while (std::getline(file, line))
+	{
+		lineno++;
+		std::istringstream fields(line);
+		scenario_step step;
+		if (!(fields >> step.op) || step.op[0] == '#')
+			continue;
+
+		if (step.op == "expect")
+		{
+			step.expect = true;
+			fields >> step.op;
+		}
+
+		bool ok = true;
+		if (step.op == "scenario" || step.op == "section")
+		{
+			std::getline(fields >> std::ws, step.name);
+		}
+		else if (step.op == "w" || step.op == "r" || step.op == "m")
+		{
+			std::string word;
+			ok = bool(fields >> std::hex >> step.target);
+			while (ok && fields >> word)
+				step.data.push_back(strtoul(word.c_str(), nullptr, 16));
+			ok = ok && !step.data.empty();
+		}
+		else if (step.op == "wait")
+		{
+			ok = bool(fields >> std::dec >> step.target);
+		}
+		else if (step.op != "irq" && step.op != "frame")
+		{
+			ok = false;
+		}
+
+		if (!ok)
+		{
+			osd_printf_error("C139 bench: %s:%u: bad scenario step '%s'\n", path, lineno, line);
+			return false;
+		}
+		m_scenario.push_back(std::move(step));
+	}
+	return true;
+}
+
+void c139bench_state::scenario_mismatch(unsigned node, const char *what, unsigned offset, uint16_t actual, uint16_t expected)
+{
+	m_mismatches++;
+	osd_printf_verbose("C139 bench: [%s] node %u %s %04x = %04x, expected %04x\n", m_scenario_section, node, what, offset, actual, expected);
+	if (m_trace.is_open())
+		m_trace << util::string_format("S %u %s %04x %04x %04x\n", node, what, offset, actual, expected);
+}
+
+TIMER_CALLBACK_MEMBER(c139bench_state::scenario_step_cb)
+{
+	// every node plays the same script, so the ring carries the capture both ways
+	while (m_scenario_pos < m_scenario.size())
+	{
+		scenario_step const &step = m_scenario[m_scenario_pos++];
+
+		if (step.op == "scenario" || step.op == "section")
+		{
+			m_scenario_section = step.name;
+		}
+		else if (step.op == "wait")
+		{
+			m_scenario_timer->adjust(attotime::from_ticks(step.target, 12'000'000));
+			return;
+		}
+		else if (step.op == "frame")
+		{
+			m_frame++;
+			m_scenario_timer->adjust(attotime::from_hz(60));
+			return;
+		}
+
+		for (unsigned node = 0; node < NODES; node++)
+		{
+			namco_c139_device &sci = *m_sci[node];
+			if (step.op == "irq")
+			{
+				if (m_irqs[node] == m_scenario_irqs[node])
+					scenario_mismatch(node, "irq", 0, 0, 1);
+				m_scenario_irqs[node] = m_irqs[node];
+			}
+			else if (step.op == "r" || (step.op == "w" && step.expect))
+			{
+				uint16_t const actual = sci.reg_r(step.target);
+				if (actual != step.data[0])
+					scenario_mismatch(node, "reg", step.target, actual, step.data[0]);
+			}
+			else if (step.op == "w")
+			{
+				sci.reg_w(step.target, step.data[0]);
+			}
+			else if (step.op == "m")
+			{
+				for (unsigned i = 0; i < step.data.size(); i++)
+				{
+					unsigned const offset = (step.target + i) & 0x1fff;
+					if (!step.expect)
+						sci.ram_w(offset, step.data[i]);
+					else if (sci.ram_r(offset) != step.data[i])
+						scenario_mismatch(node, "ram", offset, sci.ram_r(offset), step.data[i]);
+				}
+			}
+		}
+	}
+
+	osd_printf_info("C139 bench: scenario finished after %u frames, %u mismatches\n", m_frame, m_mismatches);
+}
+
+
+//-------------------------------------------------
+//  bus bridge
+//-------------------------------------------------
+
+bool c139bench_state::bus_accept()
+{
+	std::error_code err;
+	asio::ip::tcp::acceptor acceptor(m_bus_ioctx);
+	asio::ip::tcp::endpoint const endpoint(asio::ip::tcp::v4(), BUS_PORT);
+	acceptor.open(endpoint.protocol(), err);
+	acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true));
+	if (!err)
+		acceptor.bind(endpoint, err);
+	if (!err)
+		acceptor.listen(1, err);
+	if (err)
+	{
+		osd_printf_error("C139 bench: cannot listen on port %u: %s\n", BUS_PORT, err.message());
+		return false;
+	}
+
+	osd_printf_info("C139 bench: waiting for the host on port %u\n", BUS_PORT);
+	acceptor.accept(m_bus_socket, err);
+	if (err)
+	{
+		osd_printf_error("C139 bench: accept failed: %s\n", err.message());
+		return false;
+	}
+	m_bus_socket.set_option(asio::ip::tcp::no_delay(true));
+	m_bus_pending.clear();
+	return true;
+}
+
+bool c139bench_state::bus_reply(uint16_t data)
+{
+	std::error_code err;
+	std::string const reply = util::string_format("%x %u\n", data, m_bus_irq ? 1 : 0);
+	asio::write(m_bus_socket, asio::buffer(reply), err);
+	return !err;
+}
+
+TIMER_CALLBACK_MEMBER(c139bench_state::bus_step)
+{
+	// param is set when a T request has run its course
+	if (param && !bus_reply(0))
+	{
+		machine().schedule_exit();
+		return;
+	}
+
+	if (!m_bus_socket.is_open() && !bus_accept())
+	{
+		machine().schedule_exit();
+		return;
+	}
+
+	namco_c139_device &sci = *m_sci[0];
+	while (true)
+	{
+		std::error_code err;
+		size_t const length = asio::read_until(m_bus_socket, asio::dynamic_buffer(m_bus_pending), '\n', err);
+		if (err)
+		{
+			osd_printf_info("C139 bench: host disconnected\n");
+			m_bus_socket.close(err);
+			machine().schedule_exit();
+			return;
+		}
+
+		std::string const line = m_bus_pending.substr(0, length - 1);
+		std::istringstream fields(line);
+		m_bus_pending.erase(0, length);
+
+		char op = 0;
+		unsigned dt = 0, addr = 0, data = 0;
+		fields >> op;
+		uint16_t result = 0;
+		switch (op)
+		{
+			case 'R':
+				fields >> dt >> std::hex >> addr;
+				result = dt ? sci.reg_r(addr & 0x07) : sci.ram_r(addr & 0x1fff);
+				break;
+
+			case 'W':
+				fields >> dt >> std::hex >> addr >> data;
+				if (dt)
+					sci.reg_w(addr & 0x07, data);
+				else
+					sci.ram_w(addr & 0x1fff, data);
+				break;
+
+			case 'T':
+				fields >> data;
+				if (data)
+				{
+					m_bus_timer->adjust(attotime::from_ticks(data, 12'000'000), 1);
+					return;
+				}
+				break;
+
+			case 'X':
+				fields >> data;
+				if (!data)
+					sci.reset();
+				break;
+
+			default:
+				osd_printf_error("C139 bench: bad bus request '%s'\n", line);
+				break;
+		}
+
+		if (!bus_reply(result))
+		{
+			machine().schedule_exit();
+			return;
+		}
+	}
+}
+
+
+//-------------------------------------------------
+//  report
+//-------------------------------------------------
+
+void c139bench_state::report()
+{
+	double const emulated = machine().time().as_double();
+	double const wall = double(osd_ticks() - m_start_ticks) / double(osd_ticks_per_second());
+	double const cpu = double(std::clock() - m_start_clock) / CLOCKS_PER_SEC;
+	if (emulated <= 0.0 || wall <= 0.0)
+		return;
+
+	if (m_trace.is_open())
+	{
+		m_trace << util::string_format("C %.6f %.6f\n", emulated, cpu);
+		m_trace.close();
+	}
+
+	// everything runs off the comm clocks, so this is an upper bound on comm_tick
+	double const ticks = emulated * double(12'000'000) * NODES;
+	osd_printf_info("C139 bench mode %02x (%s): %.3f emulated seconds in %.3f seconds (%.2f emulated seconds per second)\n",
+			m_mode, IMPL_NAME, emulated, wall, emulated / wall);
+	osd_printf_info("  cpu time: %.1f ms per emulated second\n", cpu * 1000.0 / emulated);
+	if (m_mode == MODE_SCENARIO)
+		osd_printf_info("  scenario: %u of %u steps played, %u mismatches\n", m_scenario_pos, m_scenario.size(), m_mismatches);
+	osd_printf_info("  comm_tick: %.1f ns per tick (%.0f ticks)\n", wall * 1e9 / ticks, ticks);
+
+#ifndef C139_OLD
+	for (unsigned node = 0; node < NODES; node++)
+	{
+		namco_c139_device::link_stats const &stats = m_sci[node]->stats();
+		namco_c139_device::jitter_stats const &jitter = m_sci[node]->rx_jitter_stats();
+		osd_printf_info("  node %u: tx %u frames (%.1f/s), rx %u frames (%.1f/s), %u irqs, %u host stalls\n",
+				node,
+				stats.tx_frames, double(stats.tx_frames) / emulated,
+				stats.rx_frames, double(stats.rx_frames) / emulated,
+				m_irqs[node], m_stalls[node]);
+		if (stats.latency.count)
+			osd_printf_info("  node %u: latency avg %u usec, min %u usec, max %u usec\n",
+					node, stats.latency.total / stats.latency.count, stats.latency.min, stats.latency.max);
+		osd_printf_info("  node %u: rx queue max %u, %u drops, %u unpaced\n",
+				node, jitter.max_depth, jitter.drops, jitter.unpaced);
+	}
+#else
+	for (unsigned node = 0; node < NODES; node++)
+		osd_printf_info("  node %u: %u irqs, %u host stalls\n", node, m_irqs[node], m_stalls[node]);
+#endif
+}
+
+
+//-------------------------------------------------
+//  machine start/reset
+//-------------------------------------------------
+
+void c139bench_state::machine_start()
+{
+	m_host_timer = timer_alloc(FUNC(c139bench_state::host_frame), this);
+	m_scenario_timer = timer_alloc(FUNC(c139bench_state::scenario_step_cb), this);
+	m_bus_timer = timer_alloc(FUNC(c139bench_state::bus_step), this);
+	// a run that plays nothing must not look like a pass
+	if (m_mode == MODE_SCENARIO && (!scenario_load("c139bench.scn") || m_scenario.empty()))
+		throw emu_fatalerror("C139 bench: no scenario to play in c139bench.scn\n");
+
+	std::fill(std::begin(m_irqs), std::end(m_irqs), 0);
+	std::fill(std::begin(m_stalls), std::end(m_stalls), 0);
+	m_start_ticks = osd_ticks();
+	m_start_clock = std::clock();
+
+	// legacy three node ring, the only one both implementations know
+	for (unsigned node = 0; node < NODES; node++)
+		m_sci[node]->sci_de_hack(node);
+
+	machine().add_notifier(MACHINE_NOTIFY_EXIT, machine_notify_delegate(&c139bench_state::report, this));
+
+	save_item(NAME(m_frame));
+	save_item(NAME(m_irqs));
+	save_item(NAME(m_stalls));
+}
+
+void c139bench_state::machine_reset()
+{
+	m_frame = 0;
+	m_quiet_frames = 0;
+	m_hold_ticks = 0;
+	if (m_trace.is_open())
+		m_trace.close();
+	if (m_config->read() & 0x01)
+	{
+		m_trace.open(util::string_format("c139bench_%s_%02x.log", IMPL_NAME, m_mode), std::ios::out | std::ios::trunc);
+		m_trace << util::string_format("H %s %02x %u\n", IMPL_NAME, m_mode, NODES);
+	}
+
+	if (m_mode == MODE_SCENARIO)
+	{
+		m_scenario_pos = 0;
+		m_mismatches = 0;
+		std::copy(std::begin(m_irqs), std::end(m_irqs), std::begin(m_scenario_irqs));
+		m_scenario_timer->adjust(attotime::zero);
+		return;
+	}
+
+	if (m_mode == MODE_BUS)
+	{
+		// node 0 belongs to the host, the other two only keep the ring closed;
+		// a soft reset can only land while a T request is in flight
+		m_bus_irq = false;
+		m_bus_timer->adjust(attotime::zero, m_bus_socket.is_open() ? 1 : 0);
+		return;
+	}
+
+	for (unsigned node = 0; node < NODES; node++)
+		host_init(node);
+
+	m_host_timer->adjust(attotime::from_hz(60), 0, attotime::from_hz(60));
+}
+
+
+//-------------------------------------------------
+//  machine config
+//-------------------------------------------------
+
+void c139bench_state::bench(machine_config &config, uint8_t mode)
+{
+	m_mode = mode;
+
+	NAMCO_C139(config, m_sci[0], 0U);
+	m_sci[0]->irq_cb().set(FUNC(c139bench_state::irq_w<0>));
+
+	NAMCO_C139(config, m_sci[1], 0U);
+	m_sci[1]->irq_cb().set(FUNC(c139bench_state::irq_w<1>));
+
+	NAMCO_C139(config, m_sci[2], 0U);
+	m_sci[2]->irq_cb().set(FUNC(c139bench_state::irq_w<2>));
+}
+
+
+ROM_START( c139b08 )
+ROM_END
+
+ROM_START( c139b09 )
+ROM_END
+
+ROM_START( c139b0c )
+ROM_END
+
+ROM_START( c139b0d )
+ROM_END
+
+ROM_START( c139bscn )
+ROM_END
+
+ROM_START( c139bbus )
+ROM_END
+
+} // anonymous namespace
+
+
+#define BENCH_FLAGS (MACHINE_NO_SOUND_HW | MACHINE_NOT_WORKING)
+
+//    YEAR  NAME      PARENT   MACHINE   INPUT      CLASS            INIT        ROT   COMPANY  FULLNAME                                 FLAGS
+GAME( 2026, c139b08,  0,       bench08,  c139bench, c139bench_state, empty_init, ROT0, "MAME",  "C139 link benchmark (mode 08)",         BENCH_FLAGS )
+GAME( 2026, c139b09,  c139b08, bench09,  c139bench, c139bench_state, empty_init, ROT0, "MAME",  "C139 link benchmark (mode 09)",         BENCH_FLAGS )
+GAME( 2026, c139b0c,  c139b08, bench0c,  c139bench, c139bench_state, empty_init, ROT0, "MAME",  "C139 link benchmark (mode 0c)",         BENCH_FLAGS )
+GAME( 2026, c139b0d,  c139b08, bench0d,  c139bench, c139bench_state, empty_init, ROT0, "MAME",  "C139 link benchmark (mode 0d)",         BENCH_FLAGS )
+GAME( 2026, c139bscn, c139b08, benchscn, c139bench, c139bench_state, empty_init, ROT0, "MAME",  "C139 link benchmark (scenario)",        BENCH_FLAGS )
+GAME( 2026, c139bbus, c139b08, benchbus, c139bench, c139bench_state, empty_init, ROT0, "MAME",  "C139 link benchmark (bus bridge)",      BENCH_FLAGS )
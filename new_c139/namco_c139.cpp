@@ -18,12 +18,18 @@
 #include "emu.h"
 #include "namco_c139.h"
 
+#include "config.h"
 #include "emuopts.h"
 #include "multibyte.h"
+#include "xmlfile.h"
+#include "debugger.h"
+#include "debug/debugcon.h"
 
 #include "asio.h"
 
+#include <deque>
 #include <iostream>
+#include <random>
 
 #define VERBOSE 0
 #include "logmacro.h"
@@ -38,10 +44,25 @@ public:
 		m_sock_rx(m_ioctx),
 		m_sock_tx(m_ioctx),
 		m_timeout_tx(m_ioctx),
+		m_retry_tx(m_ioctx),
+		m_backoff(RETRY_MIN),
 		m_stopping(false),
 		m_forward(false),
+		m_sending(false),
 		m_state_rx(0U),
-		m_state_tx(0U)
+		m_state_tx(0U),
+		m_established(false),
+		m_session(std::random_device()()),
+		m_tx_seq(0),
+		m_resend_seq(0),
+		m_rx_session(0),
+		m_rx_seq(0),
+		m_linkid(0),
+		m_peer_linkid(-1),
+		m_reject(REJECT_NONE),
+		m_offer_caps(0),
+		m_tx_caps(0),
+		m_rx_caps(0)
 	{
 	}
 
@@ -62,10 +83,10 @@ public:
 			});
 	}
 
-	void reset(std::string localhost, std::string localport, std::string remotehost, std::string remoteport, bool forward)
+	void reset(std::string localhost, std::string localport, std::string remotehost, std::string remoteport, uint8_t linkid, bool forward, bool compress)
 	{
 		m_ioctx.post(
-			[this, localhost = std::move(localhost), localport = std::move(localport), remotehost = std::move(remotehost), remoteport = std::move(remoteport), forward = std::move(forward)] ()
+			[this, localhost = std::move(localhost), localport = std::move(localport), remotehost = std::move(remotehost), remoteport = std::move(remoteport), linkid, forward = std::move(forward), compress] ()
 			{
 				std::error_code err;
 				asio::ip::tcp::resolver resolver(m_ioctx);
@@ -90,7 +111,9 @@ public:
 					LOG("C139: remotehost resolve error: %s\n", err.message());
 				}
 
+				m_linkid = linkid;
 				m_forward = forward;
+				m_offer_caps = compress ? CAP_DELTA : 0;
 				if (m_acceptor.is_open())
 					m_acceptor.close(err);
 				if (m_sock_rx.is_open())
@@ -98,8 +121,20 @@ public:
 				if (m_sock_tx.is_open())
 					m_sock_tx.close(err);
 				m_timeout_tx.cancel();
+				m_retry_tx.cancel();
 				m_state_rx.store(0);
 				m_state_tx.store(0);
+
+				// a reset starts a new session, nothing to resync
+				m_established.store(false);
+				m_session = std::random_device()();
+				m_tx_seq = 0;
+				m_resend_seq = 0;
+				m_sending = false;
+				m_backoff = RETRY_MIN;
+				m_peer_linkid.store(-1);
+				m_reject.store(REJECT_NONE);
+
 				start_accept();
 				start_connect();
 			});
@@ -119,6 +154,7 @@ public:
 				if (m_sock_tx.is_open())
 					m_sock_tx.close(err);
 				m_timeout_tx.cancel();
+				m_retry_tx.cancel();
 				m_state_rx.store(0);
 				m_state_tx.store(0);
 				m_ioctx.stop();
@@ -138,12 +174,24 @@ public:
 		return m_state_rx.load() == 2 && m_state_tx.load() == 2;
 	}
 
+	unsigned rx_high_water() { return m_fifo_rx.high_water(); }
+	unsigned tx_high_water() { return m_fifo_tx.high_water(); }
+	unsigned rx_used() { return m_fifo_rx.used(); }
+	unsigned tx_used() { return m_fifo_tx.used(); }
+	unsigned rx_state() { return m_state_rx.load(); }
+	unsigned tx_state() { return m_state_tx.load(); }
+	int peer_linkid() { return m_peer_linkid.load(); }
+	bool compressed() { return m_tx_caps.load() & CAP_DELTA; }
+	const char *reject_reason() { return REJECT_NAMES[m_reject.load()]; }
+
 	unsigned receive(uint8_t* buffer, unsigned data_size)
 	{
-		if (m_state_rx.load() < 2)
+		// frames received before a connection drop are still delivered
+		unsigned const used = m_fifo_rx.used();
+		if (m_state_rx.load() < 2 && used == 0)
 			return UINT_MAX;
 
-		if (data_size > m_fifo_rx.used())
+		if (data_size > used)
 			return 0;
 
 		return m_fifo_rx.read(&buffer[0], data_size, false);
@@ -151,7 +199,8 @@ public:
 
 	unsigned send(uint8_t* buffer, unsigned data_size)
 	{
-		if (m_state_tx.load() < 2)
+		// keep queueing while reconnecting to a known peer
+		if (m_state_tx.load() < 2 && !m_established.load())
 			return UINT_MAX;
 
 		if (data_size > m_fifo_tx.free())
@@ -172,12 +221,195 @@ public:
 	}
 
 private:
+	static constexpr uint32_t HELLO_MAGIC = 0x43313339; // "C139"
+	static constexpr uint16_t PROTOCOL_VERSION = 2;
+	static constexpr uint8_t TIMING_12MHZ = 1;          // frames paced by the emulated 12MHz comm clock
+	static constexpr unsigned HELLO_SIZE = 24;
+	static constexpr unsigned REPLY_SIZE = 16;
+
+	enum : uint8_t
+	{
+		REJECT_NONE = 0,
+		REJECT_VERSION,
+		REJECT_FORMAT,
+		REJECT_TIMING
+	};
+	static constexpr const char *REJECT_NAMES[4] = { "none", "protocol version", "frame format", "timing mode" };
+	static constexpr unsigned HISTORY_SIZE = 32;
+	static constexpr std::chrono::milliseconds RETRY_MIN = std::chrono::milliseconds(1);
+	static constexpr std::chrono::milliseconds RETRY_MAX = std::chrono::milliseconds(1000);
+	static constexpr std::chrono::milliseconds CONNECT_TIMEOUT = std::chrono::milliseconds(2000);
+
+	// negotiated wire options
+	static constexpr uint32_t CAP_DELTA = 0x00000001;
+
+	// xor-delta against the last frame of the same link id, with zero-run encoding
+	class codec
+	{
+	public:
+		enum : uint8_t
+		{
+			TYPE_RAW = 0,
+			TYPE_KEY = 1,
+			TYPE_DELTA = 2
+		};
+
+		static constexpr unsigned HEADER_SIZE = 4;      // length (16 bit), type, link id
+		static constexpr unsigned WIRE_SIZE = HEADER_SIZE + FRAME_SIZE + (FRAME_SIZE / 128) + 1;
+		static constexpr unsigned KEYFRAME_INTERVAL = 60;
+
+		void clear()
+		{
+			for (reference &ref : m_refs)
+				ref.valid = false;
+		}
+
+		unsigned encode(const uint8_t *frame, uint8_t *wire)
+		{
+			uint8_t const linkid = frame[0x1fe];
+			reference &ref = m_refs[linkid];
+
+			uint8_t delta[FRAME_SIZE];
+			uint8_t type = TYPE_KEY;
+			if (ref.valid && ref.age < KEYFRAME_INTERVAL)
+			{
+				type = TYPE_DELTA;
+				for (unsigned i = 0; i < FRAME_SIZE; i++)
+					delta[i] = frame[i] ^ ref.data[i];
+				ref.age++;
+			}
+			else
+			{
+				std::copy_n(&frame[0], FRAME_SIZE, &delta[0]);
+				ref.age = 0;
+			}
+			ref.valid = true;
+			std::copy_n(&frame[0], FRAME_SIZE, ref.data.begin());
+
+			unsigned length = pack(&delta[0], &wire[HEADER_SIZE]);
+			if (length >= FRAME_SIZE)
+			{
+				// incompressible, send as is
+				type = TYPE_RAW;
+				length = FRAME_SIZE;
+				std::copy_n(&frame[0], FRAME_SIZE, &wire[HEADER_SIZE]);
+				ref.age = 0;
+			}
+
+			put_u16be(&wire[0], length);
+			wire[2] = type;
+			wire[3] = linkid;
+			return HEADER_SIZE + length;
+		}
+
+		bool decode(const uint8_t *header, const uint8_t *body, uint8_t *frame)
+		{
+			unsigned const length = get_u16be(&header[0]);
+			uint8_t const type = header[2];
+			reference &ref = m_refs[header[3]];
+
+			switch (type)
+			{
+				case TYPE_RAW:
+					if (length != FRAME_SIZE)
+						return false;
+					std::copy_n(&body[0], FRAME_SIZE, &frame[0]);
+					break;
+
+				case TYPE_KEY:
+					if (!unpack(&body[0], length, &frame[0]))
+						return false;
+					break;
+
+				case TYPE_DELTA:
+					if (!ref.valid || !unpack(&body[0], length, &frame[0]))
+						return false;
+					for (unsigned i = 0; i < FRAME_SIZE; i++)
+						frame[i] ^= ref.data[i];
+					break;
+
+				default:
+					return false;
+			}
+
+			ref.valid = true;
+			std::copy_n(&frame[0], FRAME_SIZE, ref.data.begin());
+			return true;
+		}
+
+	private:
+		struct reference
+		{
+			bool valid = false;
+			unsigned age = 0;
+			std::array<uint8_t, FRAME_SIZE> data;
+		};
+
+		// control byte 0x00-0x7f: 1-128 literal bytes follow, 0x80-0xff: run of 1-128 zero bytes
+		static unsigned pack(const uint8_t *src, uint8_t *dst)
+		{
+			unsigned in = 0;
+			unsigned out = 0;
+			while (in < FRAME_SIZE)
+			{
+				unsigned run = 0;
+				while ((in + run) < FRAME_SIZE && run < 128 && src[in + run] == 0)
+					run++;
+				if (run > 0)
+				{
+					dst[out++] = 0x80 | (run - 1);
+					in += run;
+					continue;
+				}
+
+				// literals up to the next pair of zeros
+				unsigned count = 0;
+				while ((in + count) < FRAME_SIZE && count < 128 && !(src[in + count] == 0 && ((in + count + 1) == FRAME_SIZE || src[in + count + 1] == 0)))
+					count++;
+				dst[out++] = count - 1;
+				std::copy_n(&src[in], count, &dst[out]);
+				in += count;
+				out += count;
+			}
+			return out;
+		}
+
+		static bool unpack(const uint8_t *src, unsigned length, uint8_t *dst)
+		{
+			unsigned in = 0;
+			unsigned out = 0;
+			while (in < length)
+			{
+				uint8_t const control = src[in++];
+				unsigned const count = (control & 0x7f) + 1;
+				if ((out + count) > FRAME_SIZE)
+					return false;
+				if (control & 0x80)
+				{
+					std::fill_n(&dst[out], count, 0);
+				}
+				else
+				{
+					if ((in + count) > length)
+						return false;
+					std::copy_n(&src[in], count, &dst[out]);
+					in += count;
+				}
+				out += count;
+			}
+			return out == FRAME_SIZE;
+		}
+
+		std::array<reference, 256> m_refs;
+	};
+
 	class fifo
 	{
 	public:
 		fifo() :
 			m_wp(0),
-			m_rp(0)
+			m_rp(0),
+			m_high(0)
 		{
 		}
 
@@ -213,6 +445,11 @@ private:
 			}
 
 			m_wp.store(current_wp, std::memory_order_release);
+
+			// track high-water mark
+			unsigned data_avail = BUFFER_SIZE - 1 - data_free + data_used;
+			if (data_avail > m_high.load(std::memory_order_relaxed))
+				m_high.store(data_avail, std::memory_order_relaxed);
 			return data_used;
 		}
 
@@ -283,6 +520,11 @@ private:
 			return (BUFFER_SIZE + current_rp - current_wp - 1 + BUFFER_SIZE) % BUFFER_SIZE;
 		}
 
+		unsigned high_water()
+		{
+			return m_high.load(std::memory_order_relaxed);
+		}
+
 		void clear()
 		{
 			m_wp.store(0, std::memory_order_release);
@@ -293,6 +535,7 @@ private:
 		static constexpr unsigned BUFFER_SIZE = 0x80000;
 		std::atomic<unsigned> m_wp;
 		std::atomic<unsigned> m_rp;
+		std::atomic<unsigned> m_high;
 		std::array<uint8_t, BUFFER_SIZE> m_buffer;
 	};
 
@@ -331,8 +574,7 @@ private:
 								m_acceptor.close(e);
 								m_sock_rx = std::move(sock);
 								m_sock_rx.set_option(asio::socket_base::keep_alive(true));
-								m_state_rx.store(2);
-								start_receive_rx();
+								start_handshake_rx();
 							}
 						});
 					m_state_rx.store(1);
@@ -354,70 +596,256 @@ private:
 		if (m_sock_tx.is_open())
 			m_sock_tx.close(err);
 		m_sock_tx.open(m_remoteaddr->protocol(), err);
-		if (!err)
+		if (err)
 		{
-			m_sock_tx.set_option(asio::ip::tcp::no_delay(true));
-			m_sock_tx.set_option(asio::socket_base::keep_alive(true));
-			osd_printf_verbose("C139: TX connecting to %s\n", *m_remoteaddr);
-			m_timeout_tx.expires_after(std::chrono::seconds(10));
-			m_timeout_tx.async_wait(
-				[this](std::error_code const& err)
+			retry_connect();
+			return;
+		}
+
+		m_sock_tx.set_option(asio::ip::tcp::no_delay(true));
+		m_sock_tx.set_option(asio::socket_base::keep_alive(true));
+		osd_printf_verbose("C139: TX connecting to %s\n", *m_remoteaddr);
+		m_timeout_tx.expires_after(CONNECT_TIMEOUT);
+		m_timeout_tx.async_wait(
+			[this](std::error_code const& err)
+			{
+				if (!err && m_state_tx.load() == 1)
 				{
-					if (!err && m_state_tx.load() == 1)
-					{
-						osd_printf_verbose("C139: TX connect timed out\n");
-						std::error_code e;
-						m_sock_tx.close(e);
-						m_state_tx.store(0);
-						start_connect();
-					}
-				});
-			m_sock_tx.async_connect(
-				*m_remoteaddr,
-				[this](std::error_code const& err)
+					osd_printf_verbose("C139: TX connect timed out\n");
+					std::error_code e;
+					m_sock_tx.close(e);
+				}
+			});
+		m_sock_tx.async_connect(
+			*m_remoteaddr,
+			[this](std::error_code const& err)
+			{
+				m_timeout_tx.cancel();
+				if (err)
 				{
-					m_timeout_tx.cancel();
-					if (err)
-					{
-						osd_printf_verbose("C139: TX connect error - %d %s\n", err.value(), err.message());
-						std::error_code e;
-						m_sock_tx.close(e);
-						m_state_tx.store(0);
-						start_connect();
-					}
-					else
+					osd_printf_verbose("C139: TX connect error - %d %s\n", err.value(), err.message());
+					retry_connect();
+				}
+				else
+				{
+					LOG("C139: TX connection established\n");
+					start_handshake_tx();
+				}
+			});
+		m_state_tx.store(1);
+	}
+
+	void retry_connect()
+	{
+		if (m_stopping)
+			return;
+
+		// exponential backoff, starting in the millisecond range
+		std::error_code e;
+		m_sock_tx.close(e);
+		m_state_tx.store(0);
+		m_sending = false;
+		m_retry_tx.expires_after(m_backoff);
+		m_retry_tx.async_wait(
+			[this](std::error_code const& err)
+			{
+				if (!err)
+					start_connect();
+			});
+		m_backoff = std::min(m_backoff * 2, RETRY_MAX);
+	}
+
+	void start_handshake_tx()
+	{
+		// hello: magic, version, frame size, link id, timing mode, session, next sequence number, offered options
+		std::fill(m_hello_tx.begin(), m_hello_tx.end(), 0);
+		put_u32be(&m_hello_tx[0], HELLO_MAGIC);
+		put_u16be(&m_hello_tx[4], PROTOCOL_VERSION);
+		put_u16be(&m_hello_tx[6], FRAME_SIZE);
+		m_hello_tx[8] = m_linkid;
+		m_hello_tx[9] = TIMING_12MHZ;
+		put_u32be(&m_hello_tx[12], m_session);
+		put_u32be(&m_hello_tx[16], m_tx_seq);
+		put_u32be(&m_hello_tx[20], m_offer_caps);
+		asio::async_write(
+			m_sock_tx,
+			asio::buffer(&m_hello_tx[0], HELLO_SIZE),
+			[this](std::error_code const& err, std::size_t length)
+			{
+				if (err)
+				{
+					LOG("C139: TX handshake error: %s\n", err.message());
+					retry_connect();
+					return;
+				}
+
+				// reply: magic, version, reject reason, link id, number of our frames the peer has seen (or ~0 for a new session), accepted options
+				asio::async_read(
+					m_sock_tx,
+					asio::buffer(&m_hello_tx[0], REPLY_SIZE),
+					[this](std::error_code const& err, std::size_t length)
 					{
-						LOG("C139: TX connection established\n");
+						if (err || get_u32be(&m_hello_tx[0]) != HELLO_MAGIC)
+						{
+							LOG("C139: TX handshake failed\n");
+							retry_connect();
+							return;
+						}
+
+						// an incompatible peer will not change its mind, give up instead of retrying
+						uint8_t const reject = std::min<uint8_t>(m_hello_tx[6], REJECT_TIMING);
+						if (reject != REJECT_NONE)
+						{
+							osd_printf_error("C139: peer rejected connection, %s mismatch (peer protocol version %u)\n", REJECT_NAMES[reject], get_u16be(&m_hello_tx[4]));
+							m_reject.store(reject);
+							std::error_code ignored;
+							m_sock_tx.close(ignored);
+							m_state_tx.store(0);
+							return;
+						}
+						m_peer_linkid.store(m_hello_tx[7]);
+
+						// resend whatever the peer missed, if we still have it
+						uint32_t const seen = get_u32be(&m_hello_tx[8]);
+						if (seen != ~uint32_t(0) && seen <= m_tx_seq && (m_tx_seq - seen) <= HISTORY_SIZE)
+							m_resend_seq = seen;
+						else
+							m_resend_seq = m_tx_seq;
+						LOG("C139: TX resync, resending %u frames\n", m_tx_seq - m_resend_seq);
+
+						// fresh codec state for every connection
+						m_tx_caps.store(get_u32be(&m_hello_tx[12]) & m_offer_caps);
+						m_encoder.clear();
+
+						m_backoff = RETRY_MIN;
+						m_established.store(true);
 						m_state_tx.store(2);
-					}
-				});
-			m_state_tx.store(1);
-		}
+						start_send_tx();
+					});
+			});
+	}
+
+	void start_handshake_rx()
+	{
+		m_state_rx.store(1);
+		asio::async_read(
+			m_sock_rx,
+			asio::buffer(&m_hello_rx[0], HELLO_SIZE),
+			[this](std::error_code const& err, std::size_t length)
+			{
+				if (err || get_u32be(&m_hello_rx[0]) != HELLO_MAGIC)
+				{
+					LOG("C139: RX handshake failed\n");
+					rx_error();
+					return;
+				}
+
+				uint16_t const version = get_u16be(&m_hello_rx[4]);
+				uint8_t reject = REJECT_NONE;
+				if (version != PROTOCOL_VERSION)
+					reject = REJECT_VERSION;
+				else if (get_u16be(&m_hello_rx[6]) != FRAME_SIZE)
+					reject = REJECT_FORMAT;
+				else if (m_hello_rx[9] != TIMING_12MHZ)
+					reject = REJECT_TIMING;
+
+				uint8_t const linkid = m_hello_rx[8];
+				if (reject != REJECT_NONE)
+					osd_printf_error("C139: rejecting peer link id %02x, %s mismatch (peer protocol version %u)\n", linkid, REJECT_NAMES[reject], version);
+				else if (linkid == m_linkid)
+					osd_printf_verbose("C139: peer has the same link id %02x as this node\n", linkid);
+
+				// same session resumes where it left off, a new one starts fresh
+				uint32_t const session = get_u32be(&m_hello_rx[12]);
+				uint32_t const tx_seq = get_u32be(&m_hello_rx[16]);
+				uint32_t seen = m_rx_seq;
+				if (reject == REJECT_NONE && session != m_rx_session)
+				{
+					m_rx_session = session;
+					m_rx_seq = tx_seq;
+					seen = ~uint32_t(0);
+				}
+				else if (reject == REJECT_NONE && (tx_seq - m_rx_seq) > HISTORY_SIZE)
+				{
+					// the sender no longer has what we missed and skips it, follow it
+					LOG("C139: RX resync, %u frames lost\n", tx_seq - m_rx_seq);
+					m_rx_seq = tx_seq;
+					seen = m_rx_seq;
+				}
+
+				// accept every option we know how to decode
+				m_rx_caps = (reject == REJECT_NONE) ? (get_u32be(&m_hello_rx[20]) & CAP_DELTA) : 0;
+				m_decoder.clear();
+
+				std::fill(m_hello_rx.begin(), m_hello_rx.end(), 0);
+				put_u32be(&m_hello_rx[0], HELLO_MAGIC);
+				put_u16be(&m_hello_rx[4], PROTOCOL_VERSION);
+				m_hello_rx[6] = reject;
+				m_hello_rx[7] = m_linkid;
+				put_u32be(&m_hello_rx[8], seen);
+				put_u32be(&m_hello_rx[12], m_rx_caps);
+				asio::async_write(
+					m_sock_rx,
+					asio::buffer(&m_hello_rx[0], REPLY_SIZE),
+					[this, reject](std::error_code const& err, std::size_t length)
+					{
+						if (err || reject != REJECT_NONE)
+						{
+							rx_error();
+							return;
+						}
+						m_state_rx.store(2);
+						start_receive_rx();
+					});
+			});
 	}
 
 	void start_send_tx()
 	{
-		if (m_stopping)
+		if (m_stopping || m_sending || m_state_tx.load() != 2)
 			return;
 
-		unsigned used = m_fifo_tx.read(&m_buffer_tx[0], std::min<unsigned>(m_fifo_tx.used(), m_buffer_tx.size()), true);
-		m_sock_tx.async_write_some(
-			asio::buffer(&m_buffer_tx[0], used),
-			[this](std::error_code const& err, std::size_t length)
+		// frames the peer missed go first, then new ones
+		bool const resend = m_resend_seq != m_tx_seq;
+		if (resend)
+			std::copy(m_history[m_resend_seq % HISTORY_SIZE].begin(), m_history[m_resend_seq % HISTORY_SIZE].end(), m_buffer_tx.begin());
+		else if (m_fifo_tx.read(&m_buffer_tx[0], FRAME_SIZE, true) != FRAME_SIZE)
+			return;
+
+		unsigned length = FRAME_SIZE;
+		const uint8_t *wire = &m_buffer_tx[0];
+		if (m_tx_caps.load() & CAP_DELTA)
+		{
+			length = m_encoder.encode(&m_buffer_tx[0], &m_wire_tx[0]);
+			wire = &m_wire_tx[0];
+		}
+
+		m_sending = true;
+		asio::async_write(
+			m_sock_tx,
+			asio::buffer(wire, length),
+			[this, resend](std::error_code const& err, std::size_t length)
 			{
-				m_fifo_tx.consume(length);
+				m_sending = false;
 				if (err)
 				{
+					// frame stays queued for the next connection
 					LOG("C139: TX connection error: %s\n", err.message().c_str());
-					m_sock_tx.close();
-					m_state_tx.store(0);
-					m_fifo_tx.clear();
-					start_connect();
+					retry_connect();
+					return;
 				}
-				else if (m_fifo_tx.used())
+
+				if (resend)
 				{
-					start_send_tx();
+					m_resend_seq++;
 				}
+				else
+				{
+					m_fifo_tx.consume(FRAME_SIZE);
+					std::copy_n(m_buffer_tx.begin(), FRAME_SIZE, m_history[m_tx_seq % HISTORY_SIZE].begin());
+					m_resend_seq = ++m_tx_seq;
+				}
+				start_send_tx();
 			});
 	}
 
@@ -426,40 +854,79 @@ private:
 		if (m_stopping)
 			return;
 
-		m_sock_rx.async_read_some(
-			asio::buffer(m_buffer_rx),
-			[this](std::error_code const& err, std::size_t length)
-			{
-				if (err || !length)
+		if (!(m_rx_caps & CAP_DELTA))
+		{
+			asio::async_read(
+				m_sock_rx,
+				asio::buffer(&m_buffer_rx[0], FRAME_SIZE),
+				[this](std::error_code const& err, std::size_t length)
 				{
 					if (err)
-						LOG("C139: RX connection error: %s\n", err.message());
-					else
-						LOG("C139: RX connection lost\n");
-					m_sock_rx.close();
-					m_state_rx.store(0);
-					m_fifo_rx.clear();
-					start_accept();
-				}
-				else
-				{
-					if (m_fifo_rx.write(&m_buffer_rx[0], length) == UINT_MAX)
 					{
-						LOG("C139: RX buffer overflow\n");
-						m_sock_rx.close();
-						m_state_rx.store(0);
-						m_fifo_rx.clear();
-						start_accept();
+						LOG("C139: RX connection error: %s\n", err.message());
+						rx_error();
 						return;
 					}
-					if (m_forward)
-						send(&m_buffer_rx[0], length);
+					complete_receive_rx();
+				});
+			return;
+		}
 
-					start_receive_rx();
+		// encoded frame, header first
+		asio::async_read(
+			m_sock_rx,
+			asio::buffer(&m_wire_rx[0], codec::HEADER_SIZE),
+			[this](std::error_code const& err, std::size_t length)
+			{
+				unsigned const body = get_u16be(&m_wire_rx[0]);
+				if (err || body > (codec::WIRE_SIZE - codec::HEADER_SIZE))
+				{
+					LOG("C139: RX connection error: %s\n", err ? err.message() : std::string("bad frame header"));
+					rx_error();
+					return;
 				}
+
+				asio::async_read(
+					m_sock_rx,
+					asio::buffer(&m_wire_rx[codec::HEADER_SIZE], body),
+					[this](std::error_code const& err, std::size_t length)
+					{
+						if (err || !m_decoder.decode(&m_wire_rx[0], &m_wire_rx[codec::HEADER_SIZE], &m_buffer_rx[0]))
+						{
+							LOG("C139: RX connection error: %s\n", err ? err.message() : std::string("undecodable frame"));
+							rx_error();
+							return;
+						}
+						complete_receive_rx();
+					});
 			});
 	}
 
+	void complete_receive_rx()
+	{
+		if (m_fifo_rx.write(&m_buffer_rx[0], FRAME_SIZE) == UINT_MAX)
+		{
+			LOG("C139: RX buffer overflow\n");
+			rx_error();
+			return;
+		}
+		m_rx_seq++;
+
+		if (m_forward)
+			send(&m_buffer_rx[0], FRAME_SIZE);
+
+		start_receive_rx();
+	}
+
+	void rx_error()
+	{
+		// complete frames already queued are kept
+		std::error_code e;
+		m_sock_rx.close(e);
+		m_state_rx.store(0);
+		start_accept();
+	}
+
 	template <typename Format, typename... Params>
 	void logerror(Format&& fmt, Params&&... args) const
 	{
@@ -480,14 +947,130 @@ private:
 	asio::ip::tcp::socket m_sock_rx;
 	asio::ip::tcp::socket m_sock_tx;
 	asio::steady_timer m_timeout_tx;
+	asio::steady_timer m_retry_tx;
+	std::chrono::milliseconds m_backoff;
 	bool m_stopping;
 	bool m_forward;
+	bool m_sending;
 	std::atomic_uint m_state_rx;
 	std::atomic_uint m_state_tx;
+	std::atomic_bool m_established;
+	uint32_t m_session;
+	uint32_t m_tx_seq;
+	uint32_t m_resend_seq;
+	uint32_t m_rx_session;
+	uint32_t m_rx_seq;
 	fifo m_fifo_rx;
 	fifo m_fifo_tx;
-	std::array<uint8_t, 0x400> m_buffer_rx;
-	std::array<uint8_t, 0x400> m_buffer_tx;
+	std::array<uint8_t, FRAME_SIZE> m_buffer_rx;
+	std::array<uint8_t, FRAME_SIZE> m_buffer_tx;
+	std::array<uint8_t, HELLO_SIZE> m_hello_rx;
+	std::array<uint8_t, HELLO_SIZE> m_hello_tx;
+	uint8_t m_linkid;
+	std::atomic<int> m_peer_linkid;
+	std::atomic<uint8_t> m_reject;
+	uint32_t m_offer_caps;
+	std::atomic<uint32_t> m_tx_caps;
+	uint32_t m_rx_caps;
+	codec m_encoder;
+	codec m_decoder;
+	std::array<uint8_t, codec::WIRE_SIZE> m_wire_tx;
+	std::array<uint8_t, codec::WIRE_SIZE> m_wire_rx;
+	std::array<std::array<uint8_t, FRAME_SIZE>, HISTORY_SIZE> m_history;
+};
+
+
+// link impairment stand-in between the device and the transport, timed in 12MHz ticks
+class namco_c139_device::fault
+{
+public:
+	fault(const fault_params &params, uint32_t seed) :
+		m_latency(uint64_t(params.latency) * 12),
+		m_jitter(uint64_t(params.jitter) * 12),
+		m_bandwidth(params.bandwidth),
+		m_loss(params.loss / 100.0f),
+		m_duplicate(params.duplicate / 100.0f),
+		m_reorder(params.reorder / 100.0f),
+		m_link_free(0),
+		m_sequence(0),
+		m_rng(seed)
+	{
+	}
+
+	bool pending() const
+	{
+		return !m_queue.empty();
+	}
+
+	void push(uint64_t now, const uint8_t *frame, unsigned data_size)
+	{
+		if (chance(m_loss))
+			return;
+
+		unsigned copies = chance(m_duplicate) ? 2 : 1;
+		for (unsigned i = 0; i < copies; i++)
+		{
+			// serialization delay at the configured bandwidth
+			uint64_t ready = std::max(now, m_link_free);
+			if (m_bandwidth)
+				ready += uint64_t(data_size) * 12'000'000 / m_bandwidth;
+			m_link_free = ready;
+
+			// propagation delay with jitter, reordered frames skip it
+			uint64_t due = ready;
+			if (!chance(m_reorder))
+			{
+				due += m_latency;
+				if (m_jitter)
+				{
+					int64_t const offset = int64_t(std::uniform_int_distribution<uint64_t>(0, m_jitter * 2)(m_rng)) - int64_t(m_jitter);
+					due = (offset < 0 && uint64_t(-offset) > due - ready) ? ready : due + offset;
+				}
+			}
+
+			entry e;
+			e.due = due;
+			e.sequence = m_sequence++;
+			std::copy_n(&frame[0], data_size, e.data.begin());
+			m_queue.insert(std::upper_bound(m_queue.begin(), m_queue.end(), e), std::move(e));
+		}
+	}
+
+	bool pop(uint64_t now, uint8_t *frame, unsigned data_size)
+	{
+		if (m_queue.empty() || m_queue.front().due > now)
+			return false;
+
+		std::copy_n(m_queue.front().data.begin(), data_size, &frame[0]);
+		m_queue.pop_front();
+		return true;
+	}
+
+private:
+	struct entry
+	{
+		uint64_t due;
+		uint64_t sequence;
+		std::array<uint8_t, FRAME_SIZE> data;
+
+		bool operator<(const entry &that) const { return (due < that.due) || ((due == that.due) && (sequence < that.sequence)); }
+	};
+
+	bool chance(float probability)
+	{
+		return (probability > 0.0f) && (std::uniform_real_distribution<float>(0.0f, 1.0f)(m_rng) < probability);
+	}
+
+	uint64_t const m_latency;
+	uint64_t const m_jitter;
+	uint32_t const m_bandwidth;
+	float const m_loss;
+	float const m_duplicate;
+	float const m_reorder;
+	uint64_t m_link_free;
+	uint64_t m_sequence;
+	std::mt19937 m_rng;
+	std::deque<entry> m_queue;
 };
 
 
@@ -503,6 +1086,18 @@ private:
 #define REG_6_RXOFFSET 6
 #define REG_7_TXOFFSET 7
 
+namespace {
+
+const char CAPTURE_MAGIC[8] = { 'C', '1', '3', '9', 'C', 'A', 'P', 1 };
+
+// host wall clock, used for one-way latency between peers
+uint64_t wall_time_usec()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // anonymous namespace
+
 // device type definition
 DEFINE_DEVICE_TYPE(NAMCO_C139, namco_c139_device, "namco_c139", "Namco C139 Serial")
 
@@ -538,15 +1133,16 @@ namco_c139_device::namco_c139_device(const machine_config &mconfig, const char *
 	m_remoteport = opts.comm_remoteport();
 	m_forward = false;
 
-	// come up with some magic number for identification
-	std::string remotehost = util::string_format("%s:%s", m_remotehost, m_remoteport);
-	m_linkid = 0;
-	for (int x = 0; x < sizeof(remotehost) && remotehost[x] != 0; x++)
-	{
-		m_linkid ^= remotehost[x];
-	}
+	// ring topology is off unless configured
+	m_ring_node = 0;
+	m_ring_size = 0;
+	m_ring_baseport = 15112;
+	m_ring_forward = "last";
+	m_ring_hosts.emplace_back("127.0.0.1");
+	m_ring_config = false;
+	m_compress = false;
 
-	LOG("C139: ID byte = %02d\n", m_linkid);
+	update_linkid();
 
 	std::fill(std::begin(m_buffer), std::end(m_buffer), 0);
 }
@@ -565,6 +1161,21 @@ void namco_c139_device::device_start()
 	m_context = std::move(ctx);
 	m_context->start();
 
+	// one command serves every C139 in the machine, the first one registers it
+	if ((machine().debug_flags & DEBUG_FLAG_ENABLED) && (device_type_enumerator<namco_c139_device>(machine().root_device()).first() == this))
+	{
+		using namespace std::placeholders;
+		machine().debugger().console().register_command("c139", CMDFLAG_NONE, 1, 3, std::bind(&namco_c139_device::debug_commands, this, _1));
+	}
+
+	// settings are kept per device, with the tag in the node name
+	std::string nodename = util::string_format("c139%s", tag());
+	std::replace(nodename.begin(), nodename.end(), ':', '.');
+	machine().configuration().config_register(
+			nodename,
+			configuration_manager::load_delegate(&namco_c139_device::config_load, this),
+			configuration_manager::save_delegate(&namco_c139_device::config_save, this));
+
 	// state saving
 	save_item(NAME(m_ram));
 	save_item(NAME(m_reg));
@@ -589,7 +1200,8 @@ void namco_c139_device::device_reset()
 	std::fill(std::begin(m_ram), std::end(m_ram), 0);
 	std::fill(std::begin(m_reg), std::end(m_reg), 0);
 
-	m_context->reset(m_localhost, m_localport, m_remotehost, m_remoteport, m_forward);
+	ring_setup();
+	m_context->reset(m_localhost, m_localport, m_remotehost, m_remoteport, m_linkid, m_forward, m_compress);
 
 	m_timer_12mhz->adjust(attotime::from_hz(12_MHz_XTAL), 0, attotime::from_hz(12_MHz_XTAL));
 
@@ -608,12 +1220,53 @@ void namco_c139_device::device_reset()
 	m_txblock = 0x0000;
 	m_txdelay = 0x0000;
 	m_rxdelay = 0x0000;
+
+	m_rxqueue_rp = 0;
+	m_rxqueue_count = 0;
+	m_rx_last_arrival = 0;
+	m_jitter = jitter_stats();
+	m_jitter.target = 1;
+	m_ticks = 0;
+
+	m_stats = link_stats();
+	m_tx_request = 0;
+
+	m_history_wp = 0;
+	m_history_count = 0;
+
+	// traffic capture
+	if (m_capture.is_open())
+		m_capture.close();
+	if (!m_capture_path.empty())
+	{
+		m_capture.open(m_capture_path, std::ios::binary | std::ios::trunc);
+		if (m_capture)
+			m_capture.write(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+		else
+			osd_printf_error("C139: unable to create capture file %s\n", m_capture_path);
+	}
+
+	replay_open();
+
+	// link impairment
+	m_fault_tx.reset(m_fault_tx_params.active() ? new fault(m_fault_tx_params, m_linkid) : nullptr);
+	m_fault_rx.reset(m_fault_rx_params.active() ? new fault(m_fault_rx_params, m_linkid ^ 0xff) : nullptr);
 }
 
 void namco_c139_device::device_stop()
 {
 	m_timer_12mhz->adjust(attotime::never);
 
+	dump_stats();
+
+	if (m_capture.is_open())
+		m_capture.close();
+	if (m_replay.is_open())
+		m_replay.close();
+
+	m_fault_tx.reset();
+	m_fault_rx.reset();
+
 	m_context->stop();
 	m_context.reset();
 
@@ -711,6 +1364,7 @@ void namco_c139_device::reg_w(offs_t offset, uint16_t data, uint16_t mem_mask)
 
 		case REG_5_TXSIZE:
 			m_txblock = data * 12;
+			m_tx_request = m_ticks;
 			break;
 
 		default:
@@ -720,42 +1374,82 @@ void namco_c139_device::reg_w(offs_t offset, uint16_t data, uint16_t mem_mask)
 
 void namco_c139_device::sci_de_hack(uint8_t data)
 {
-	// prepare "filenames"
-	switch (data)
+	// legacy 3 node loopback ring, unless a ring is configured
+	if (!m_ring_config)
+		m_ring_node = data;
+	if (m_ring_size == 0)
+		m_ring_size = 3;
+
+	ring_setup();
+}
+
+void namco_c139_device::ring_setup()
+{
+	if (m_ring_size == 0)
+		return;
+
+	if (m_ring_size > RING_MAX_NODES)
 	{
-		case 0:
-			m_localhost = "127.0.0.1";
-			m_localport = "15112";
-			m_remotehost = "127.0.0.1";
-			m_remoteport = "15113";
-			break;
-		case 1:
-			m_localhost = "127.0.0.1";
-			m_localport = "15113";
-			m_remotehost = "127.0.0.1";
-			m_remoteport = "15114";
-			break;
-		case 2:
-			m_localhost = "127.0.0.1";
-			m_localport = "15114";
-			m_remotehost = "127.0.0.1";
-			m_remoteport = "15112";
+		osd_printf_error("C139: ring size %u exceeds %u nodes\n", m_ring_size, RING_MAX_NODES);
+		m_ring_size = RING_MAX_NODES;
+	}
+
+	// each node listens on baseport + node and connects to the next node in the ring
+	unsigned const node = m_ring_node;
+	unsigned const next = (node + 1) % m_ring_size;
+	auto const host =
+		[this] (unsigned index) -> const std::string &
+		{
+			return m_ring_hosts[(index < m_ring_hosts.size()) ? index : 0];
+		};
+
+	if (node < m_ring_size)
+	{
+		m_localhost = host(node);
+		m_localport = util::string_format("%u", m_ring_baseport + node);
+		m_remotehost = host(next);
+		m_remoteport = util::string_format("%u", m_ring_baseport + next);
+
+		if (m_ring_forward == "all")
 			m_forward = true;
-			break;
-		default:
-			m_localhost = "127.0.0.1";
-			m_localport = "15112";
-			m_remotehost = "127.0.0.1";
-			m_remoteport = "15112";
-			break;
+		else if (m_ring_forward == "none")
+			m_forward = false;
+		else if (m_ring_forward == "last")
+			m_forward = (node == m_ring_size - 1U);
+		else
+			m_forward = (node == strtoul(m_ring_forward.c_str(), nullptr, 10));
+	}
+	else
+	{
+		// not part of the ring, loop back to ourselves
+		m_localhost = host(0);
+		m_localport = util::string_format("%u", m_ring_baseport);
+		m_remotehost = host(0);
+		m_remoteport = util::string_format("%u", m_ring_baseport);
+		m_forward = false;
+	}
+
+	LOG("C139: ring node %u/%u, %s:%s -> %s:%s%s\n", node, m_ring_size, m_localhost, m_localport, m_remotehost, m_remoteport, m_forward ? " (forwarding)" : "");
+
+	update_linkid();
+}
+
+void namco_c139_device::update_linkid()
+{
+	// in a ring the node index is unique, whatever the hosts and ports are
+	if (m_ring_size != 0)
+	{
+		m_linkid = m_ring_node;
+		LOG("C139: ID byte = %02d\n", m_linkid);
+		return;
 	}
 
 	// come up with some magic number for identification
 	std::string remotehost = util::string_format("%s:%s", m_remotehost, m_remoteport);
 	m_linkid = 0;
-	for (int x = 0; x < sizeof(remotehost) && remotehost[x] != 0; x++)
+	for (char c : remotehost)
 	{
-		m_linkid ^= remotehost[x];
+		m_linkid ^= c;
 	}
 
 	LOG("C139: ID byte = %02d\n", m_linkid);
@@ -864,53 +1558,168 @@ void namco_c139_device::comm_tick()
 	if (m_rxdelay > 0)
 		m_rxdelay--;
 
-	unsigned data_size = 0x200;
+	m_ticks++;
+
+	unsigned data_size = FRAME_SIZE;
 	if (m_txblock == 0 && m_txdelay == 0)
 		send_data(data_size);
 
+	if (m_fault_tx && m_fault_tx->pending())
+		send_fault_frames(data_size);
+
+	queue_data(data_size);
 	if (m_rxdelay == 0)
 		read_data(data_size);
 }
 
-void namco_c139_device::read_data(unsigned data_size)
+void namco_c139_device::queue_data(unsigned data_size)
 {
-	// try to read a message
-	unsigned recv = read_frame(data_size);
-	if (recv > 0)
+	// move every frame that has arrived into the jitter buffer
+	while (true)
 	{
-		// save message to "rx buffer"
-		unsigned rx_size = m_buffer[0x1ff];
-		unsigned rx_offset = m_reg[REG_6_RXOFFSET]; // rx offset in words
-		LOG("C139: rx_offset = %04x, rx_size == %02x\n", rx_offset, rx_size);
-		unsigned buf_offset = 0;
-		for (unsigned j = 0x00; j < rx_size; j++)
+		bool const full = m_rxqueue_count == RX_QUEUE_SIZE;
+		unsigned wp = (m_rxqueue_rp + m_rxqueue_count) % RX_QUEUE_SIZE;
+		if (read_frame(full ? &m_buffer[0] : &m_rxqueue[wp][0], data_size) == 0)
+			break;
+
+		if (full)
 		{
-			uint16_t data = get_u16be(&m_buffer[buf_offset]);
-			m_ram[0x1000 + (rx_offset & 0x0fff)] = data;
+			// buffer full, oldest frame is stale
+			drop_stale_frame("rx queue full");
+			std::copy_n(&m_buffer[0], data_size, &m_rxqueue[wp][0]);
+		}
+
+		m_rxqueue_time[wp] = m_ticks;
+		m_rxqueue_count++;
+		record_frame(false, &m_rxqueue[wp][0]);
 
-			// check sync-bit
-			if (data & 0x0100)
-				m_reg[REG_0_STATUS] |= 0x02;
+		m_stats.rx_frames++;
+		m_stats.rx_bytes += data_size;
+		uint64_t const sent = get_u64be(&m_rxqueue[wp][FRAME_TIMESTAMP]);
+		uint64_t const now = wall_time_usec();
+		if (sent != 0 && now >= sent)
+			m_stats.latency.add(now - sent);
 
-			rx_offset++;
-			buf_offset += 2;
+		// smoothed inter-arrival time and jitter (rfc 3550 style)
+		if (m_rx_last_arrival != 0)
+		{
+			int32_t interval = int32_t(std::min<uint64_t>(m_ticks - m_rx_last_arrival, INT32_MAX));
+			if (m_jitter.interval == 0)
+				m_jitter.interval = interval;
+			else
+				m_jitter.interval += (interval - int32_t(m_jitter.interval)) / 8;
+
+			int32_t deviation = std::abs(interval - int32_t(m_jitter.interval));
+			m_jitter.jitter += (deviation - int32_t(m_jitter.jitter)) / 16;
 		}
+		m_rx_last_arrival = m_ticks;
+
+		// hold enough frames to cover the jitter
+		unsigned target = 1;
+		if (m_jitter.interval > 0)
+			target += (m_jitter.jitter + m_jitter.interval - 1) / m_jitter.interval;
+		m_jitter.target = std::min(target, RX_QUEUE_SIZE / 2);
+	}
+
+	m_jitter.depth = m_rxqueue_count;
+	m_jitter.max_depth = std::max(m_jitter.max_depth, m_rxqueue_count);
+	m_stats.rx_fifo_max = m_context->rx_high_water();
+}
 
-		// update regs
-		m_reg[REG_4_RXSIZE] -= rx_size;
-		m_reg[REG_6_RXOFFSET] += rx_size;
+void namco_c139_device::read_data(unsigned data_size)
+{
+	if (m_rxqueue_count == 0)
+		return;
+
+	unsigned threshold = m_jitter.target + RX_QUEUE_SLACK;
+
+	// backlog way beyond the target, drop stale frames
+	while (m_rxqueue_count > threshold * 2)
+		drop_stale_frame("backlog");
+
+	// wait for the target depth, unless the head frame waited long enough
+	if (m_rxqueue_count < m_jitter.target && (m_ticks - m_rxqueue_time[m_rxqueue_rp]) < m_jitter.jitter)
+		return;
 
-		// prevent overflow
-		m_reg[REG_4_RXSIZE] &= 0x00ff;
-		m_reg[REG_6_RXOFFSET] &= 0x0fff;
+	write_frame(&m_rxqueue[m_rxqueue_rp][0]);
+	m_stats.rx_time.add(m_ticks - m_rxqueue_time[m_rxqueue_rp]);
+	m_rxqueue_rp = (m_rxqueue_rp + 1) % RX_QUEUE_SIZE;
+	m_rxqueue_count--;
+	m_jitter.depth = m_rxqueue_count;
+	m_jitter.frames++;
 
-		m_rxdelay = rx_size * 12;
+	// backlog beyond the threshold, write the next frame without pacing
+	if (m_rxqueue_count > threshold)
+	{
+		m_rxdelay = 0;
+		m_jitter.unpaced++;
 	}
 }
 
-unsigned namco_c139_device::read_frame(unsigned data_size)
+void namco_c139_device::drop_stale_frame(const char *reason)
+{
+	// the game never sees a dropped frame, so at least say so once
+	uint8_t const *frame = &m_rxqueue[m_rxqueue_rp][0];
+	if (!m_jitter.drops)
+		osd_printf_warning("C139 %s: dropping stale rx frames (%s), -verbose lists each one\n", tag(), reason);
+	osd_printf_verbose("C139 %s: dropped rx frame of %u words after %u ticks in the queue (%s, %u queued)\n",
+			tag(), frame[0x1ff], uint32_t(m_ticks - m_rxqueue_time[m_rxqueue_rp]), reason, m_rxqueue_count);
+
+	m_rxqueue_rp = (m_rxqueue_rp + 1) % RX_QUEUE_SIZE;
+	m_rxqueue_count--;
+	m_jitter.drops++;
+}
+
+void namco_c139_device::write_frame(const uint8_t *frame)
 {
-	unsigned bytes_read = m_context->receive(&m_buffer[0], data_size);
+	// save message to "rx buffer"
+	unsigned rx_size = frame[0x1ff];
+	unsigned rx_offset = m_reg[REG_6_RXOFFSET]; // rx offset in words
+	LOG("C139: rx_offset = %04x, rx_size == %02x\n", rx_offset, rx_size);
+	unsigned buf_offset = 0;
+	for (unsigned j = 0x00; j < rx_size; j++)
+	{
+		uint16_t data = get_u16be(&frame[buf_offset]);
+		m_ram[0x1000 + (rx_offset & 0x0fff)] = data;
+
+		// check sync-bit
+		if (data & 0x0100)
+			m_reg[REG_0_STATUS] |= 0x02;
+
+		rx_offset++;
+		buf_offset += 2;
+	}
+
+	// update regs
+	m_reg[REG_4_RXSIZE] -= rx_size;
+	m_reg[REG_6_RXOFFSET] += rx_size;
+
+	// prevent overflow
+	m_reg[REG_4_RXSIZE] &= 0x00ff;
+	m_reg[REG_6_RXOFFSET] &= 0x0fff;
+
+	m_rxdelay = rx_size * 12;
+}
+
+unsigned namco_c139_device::read_frame(uint8_t *buffer, unsigned data_size)
+{
+	if (!m_fault_rx)
+		return read_transport(buffer, data_size);
+
+	// everything the transport delivered goes through the impairment queue
+	uint8_t frame[FRAME_SIZE];
+	while (read_transport(&frame[0], data_size) > 0)
+		m_fault_rx->push(m_ticks, &frame[0], data_size);
+
+	return m_fault_rx->pop(m_ticks, buffer, data_size) ? data_size : 0;
+}
+
+unsigned namco_c139_device::read_transport(uint8_t *buffer, unsigned data_size)
+{
+	if (m_replay.is_open())
+		return replay_frame(buffer, data_size);
+
+	unsigned bytes_read = m_context->receive(&buffer[0], data_size);
 	if (bytes_read == UINT_MAX)
 	{
 		// ignore errors
@@ -935,6 +1744,7 @@ void namco_c139_device::send_data(unsigned data_size)
 
 	m_buffer[0x1fe] = m_linkid;
 	m_buffer[0x1ff] = tx_size;
+	put_u64be(&m_buffer[FRAME_TIMESTAMP], wall_time_usec());
 
 	// mode 8 (ridgera2) has sync bit set in data (faulty)
 	// mode 8 (raverace) has sync bit set in data (faulty)
@@ -965,9 +1775,480 @@ void namco_c139_device::send_data(unsigned data_size)
 
 void namco_c139_device::send_frame(unsigned data_size)
 {
-	unsigned bytes_sent = m_context->send(&m_buffer[0], data_size);
+	unsigned bytes_sent = data_size;
+	if (m_fault_tx)
+		m_fault_tx->push(m_ticks, &m_buffer[0], data_size);
+	else
+		bytes_sent = m_context->send(&m_buffer[0], data_size);
+
 	if (bytes_sent == UINT_MAX)
 	{
 		// ignore errors
+		return;
+	}
+
+	record_frame(true, &m_buffer[0]);
+
+	m_stats.tx_frames++;
+	m_stats.tx_bytes += bytes_sent;
+	m_stats.tx_time.add(m_ticks - m_tx_request);
+	m_stats.tx_fifo_max = m_context->tx_high_water();
+}
+
+void namco_c139_device::send_fault_frames(unsigned data_size)
+{
+	// hand over impaired frames once they are due
+	uint8_t frame[FRAME_SIZE];
+	while (m_fault_tx->pop(m_ticks, &frame[0], data_size))
+		m_context->send(&frame[0], data_size);
+}
+
+
+//**************************************************************************
+//  STATISTICS
+//**************************************************************************
+
+void namco_c139_device::histogram::add(uint64_t value)
+{
+	if (count == 0 || value < min)
+		min = value;
+	if (value > max)
+		max = value;
+	count++;
+	total += value;
+
+	unsigned bucket = 0;
+	while (bucket < std::size(buckets) - 1 && (value >> bucket) != 0)
+		bucket++;
+	buckets[bucket]++;
+}
+
+void namco_c139_device::record_frame(bool tx, const uint8_t *frame)
+{
+	// the history is only there for the debugger commands
+	if (machine().debug_flags & DEBUG_FLAG_ENABLED)
+	{
+		frame_record &rec = m_history[m_history_wp];
+		rec.ticks = m_ticks;
+		rec.tx = tx;
+		std::copy_n(&frame[0], FRAME_SIZE, &rec.data[0]);
+
+		m_history_wp = (m_history_wp + 1) % FRAME_HISTORY;
+		if (m_history_count < FRAME_HISTORY)
+			m_history_count++;
+	}
+
+	if (m_capture.is_open())
+		capture_frame(tx, frame);
+}
+
+
+//**************************************************************************
+//  CAPTURE / REPLAY
+//**************************************************************************
+
+/*
+    capture file format (all values little endian)
+
+    header:
+        8 bytes     magic "C139CAP" + version byte
+
+    one record per frame:
+        8 bytes     12MHz ticks since reset
+        1 byte      direction (0 = rx, 1 = tx)
+        1 byte      link id
+        1 byte      size in words
+        2 * size    payload words (9 bit data)
+*/
+
+void namco_c139_device::capture_frame(bool tx, const uint8_t *frame)
+{
+	unsigned const size = frame[0x1ff];
+
+	uint8_t header[11];
+	put_u64le(&header[0], m_ticks);
+	header[8] = tx ? 1 : 0;
+	header[9] = frame[0x1fe];
+	header[10] = size;
+	m_capture.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+	uint8_t words[0x200];
+	for (unsigned j = 0; j < size; j++)
+		put_u16le(&words[j * 2], get_u16be(&frame[j * 2]));
+	m_capture.write(reinterpret_cast<const char *>(words), size * 2);
+}
+
+void namco_c139_device::replay_open()
+{
+	if (m_replay.is_open())
+		m_replay.close();
+	m_replay_ticks = ~uint64_t(0);
+	if (m_replay_path.empty())
+		return;
+
+	m_replay.open(m_replay_path, std::ios::binary);
+	char magic[sizeof(CAPTURE_MAGIC)];
+	if (!m_replay.read(magic, sizeof(magic)) || !std::equal(std::begin(magic), std::end(magic), std::begin(CAPTURE_MAGIC)))
+	{
+		osd_printf_error("C139: %s is not a valid capture file\n", m_replay_path);
+		m_replay.close();
+		return;
 	}
+
+	osd_printf_verbose("C139: replaying %s\n", m_replay_path);
+	replay_next();
+}
+
+bool namco_c139_device::replay_next()
+{
+	// fetch the next received frame, transmitted ones belong to us
+	uint8_t header[11];
+	while (m_replay.read(reinterpret_cast<char *>(header), sizeof(header)))
+	{
+		unsigned const size = header[10];
+		uint8_t words[0x200];
+		if (!m_replay.read(reinterpret_cast<char *>(words), size * 2))
+			break;
+		if (header[8] != 0)
+			continue;
+
+		std::fill(std::begin(m_replay_frame), std::end(m_replay_frame), 0);
+		for (unsigned j = 0; j < size; j++)
+			put_u16be(&m_replay_frame[j * 2], get_u16le(&words[j * 2]));
+		m_replay_frame[0x1fe] = header[9];
+		m_replay_frame[0x1ff] = size;
+		m_replay_ticks = get_u64le(&header[0]);
+		return true;
+	}
+
+	m_replay_ticks = ~uint64_t(0);
+	return false;
+}
+
+unsigned namco_c139_device::replay_frame(uint8_t *buffer, unsigned data_size)
+{
+	if (m_ticks < m_replay_ticks)
+		return 0;
+
+	std::copy_n(&m_replay_frame[0], data_size, &buffer[0]);
+	replay_next();
+	return data_size;
+}
+
+
+//**************************************************************************
+//  CONFIGURATION
+//**************************************************************************
+
+void namco_c139_device::config_load(config_type cfg_type, config_level cfg_level, util::xml::data_node const *parentnode)
+{
+	if ((cfg_type != config_type::SYSTEM) || !parentnode)
+		return;
+
+	util::xml::data_node const *const node = parentnode->get_child("link");
+	if (node)
+	{
+		m_capture_path = node->get_attribute_string("capture", "");
+		m_replay_path = node->get_attribute_string("replay", "");
+		m_compress = node->get_attribute_int("compress", 0) != 0;
+	}
+
+	util::xml::data_node const *const ring = parentnode->get_child("ring");
+	if (ring)
+	{
+		m_ring_config = true;
+		m_ring_node = ring->get_attribute_int("node", m_ring_node);
+		m_ring_size = ring->get_attribute_int("size", m_ring_size);
+		m_ring_baseport = ring->get_attribute_int("baseport", m_ring_baseport);
+		m_ring_forward = ring->get_attribute_string("forward", m_ring_forward.c_str());
+
+		// comma separated host list, one per node, or a single host for all
+		std::string const hosts = ring->get_attribute_string("hosts", "");
+		if (!hosts.empty())
+		{
+			m_ring_hosts.clear();
+			std::string::size_type start = 0;
+			while (start <= hosts.size())
+			{
+				std::string::size_type const end = std::min(hosts.find(',', start), hosts.size());
+				m_ring_hosts.emplace_back(hosts.substr(start, end - start));
+				start = end + 1;
+			}
+		}
+	}
+
+	auto const load_fault =
+		[parentnode] (const char *name, fault_params &params)
+		{
+			util::xml::data_node const *const node = parentnode->get_child(name);
+			params = fault_params();
+			if (node)
+			{
+				params.latency = node->get_attribute_int("latency", 0);
+				params.jitter = node->get_attribute_int("jitter", 0);
+				params.bandwidth = node->get_attribute_int("bandwidth", 0);
+				params.loss = node->get_attribute_float("loss", 0.0f);
+				params.duplicate = node->get_attribute_float("duplicate", 0.0f);
+				params.reorder = node->get_attribute_float("reorder", 0.0f);
+			}
+		};
+	load_fault("fault_tx", m_fault_tx_params);
+	load_fault("fault_rx", m_fault_rx_params);
+}
+
+void namco_c139_device::config_save(config_type cfg_type, util::xml::data_node *parentnode)
+{
+	if (cfg_type != config_type::SYSTEM)
+		return;
+
+	if (!m_capture_path.empty() || !m_replay_path.empty() || m_compress)
+	{
+		util::xml::data_node *const node = parentnode->add_child("link", nullptr);
+		if (node)
+		{
+			if (m_compress)
+				node->set_attribute_int("compress", 1);
+			if (!m_capture_path.empty())
+				node->set_attribute("capture", m_capture_path);
+			if (!m_replay_path.empty())
+				node->set_attribute("replay", m_replay_path);
+		}
+	}
+
+	if (m_ring_config)
+	{
+		util::xml::data_node *const node = parentnode->add_child("ring", nullptr);
+		if (node)
+		{
+			std::string hosts;
+			for (const std::string &host : m_ring_hosts)
+				hosts += (hosts.empty() ? "" : ",") + host;
+
+			node->set_attribute_int("node", m_ring_node);
+			node->set_attribute_int("size", m_ring_size);
+			node->set_attribute_int("baseport", m_ring_baseport);
+			node->set_attribute("forward", m_ring_forward);
+			node->set_attribute("hosts", hosts);
+		}
+	}
+
+	auto const save_fault =
+		[parentnode] (const char *name, const fault_params &params)
+		{
+			if (!params.active())
+				return;
+
+			util::xml::data_node *const node = parentnode->add_child(name, nullptr);
+			if (node)
+			{
+				node->set_attribute_int("latency", params.latency);
+				node->set_attribute_int("jitter", params.jitter);
+				node->set_attribute_int("bandwidth", params.bandwidth);
+				node->set_attribute_float("loss", params.loss);
+				node->set_attribute_float("duplicate", params.duplicate);
+				node->set_attribute_float("reorder", params.reorder);
+			}
+		};
+	save_fault("fault_tx", m_fault_tx_params);
+	save_fault("fault_rx", m_fault_rx_params);
+}
+
+
+//**************************************************************************
+//  DEBUGGER COMMANDS
+//**************************************************************************
+
+void namco_c139_device::debug_commands(const std::vector<std::string_view> &params)
+{
+	debugger_console &con = machine().debugger().console();
+
+	// a device tag in front of the subcommand picks the node, otherwise it is this one
+	static const char *const COMMANDS[] = { "status", "fifo", "frames", "peek", "stats" };
+	namco_c139_device *device = this;
+	size_t first = 0;
+	if (std::find(std::begin(COMMANDS), std::end(COMMANDS), params[0]) == std::end(COMMANDS))
+	{
+		device = dynamic_cast<namco_c139_device *>(machine().root_device().subdevice(params[0]));
+		if (!device)
+		{
+			con.printf("No C139 device '%s'\n", params[0]);
+			return;
+		}
+		first = 1;
+	}
+
+	if (params.size() <= first)
+	{
+		con.printf("Usage: c139 [<tag>] status|fifo|frames [n]|peek [n]|stats\n");
+		return;
+	}
+
+	std::string_view const command = params[first];
+	bool const has_value = params.size() > first + 1;
+	u64 value = FRAME_HISTORY;
+	if (has_value && !con.validate_number_parameter(params[first + 1], value))
+		return;
+
+	if (command == "status" && !has_value)
+		device->debug_status();
+	else if (command == "fifo" && !has_value)
+		device->debug_fifo();
+	else if (command == "frames")
+		device->debug_frames(value);
+	else if (command == "peek")
+		device->debug_peek(has_value ? value : 0);
+	else if (command == "stats" && !has_value)
+		device->debug_stats();
+	else
+		con.printf("Usage: c139 [<tag>] status|fifo|frames [n]|peek [n]|stats\n");
+}
+
+void namco_c139_device::debug_status()
+{
+	debugger_console &con = machine().debugger().console();
+
+	static const char *const MODE_NAMES[4] =
+	{
+		"int on tx complete (or rxsize/txsize == 0)",
+		"int on rx complete (or rxsize == 0 / sync-bit)",
+		"int on tx complete (or txsize == 0)",
+		"int on sync-bit"
+	};
+
+	uint16_t const mode = m_reg[REG_1_MODE];
+	uint16_t const status = reg_r(REG_0_STATUS);
+	con.printf("regs:   %04x %04x %04x %04x %04x %04x %04x %04x\n",
+			status, m_reg[1], m_reg[2], m_reg[3], m_reg[4], m_reg[5], m_reg[6], m_reg[7]);
+	con.printf("mode:   %x - %s%s%s\n",
+			mode,
+			(mode >= 0x0e) ? "no int / config" : MODE_NAMES[mode >> 2],
+			BIT(mode, 0) ? ", tx sync-bit from data" : ", tx sync-bit on last word",
+			BIT(mode, 1) ? ", ignore sync-bit" : "");
+	con.printf("status: %s%s%s\n",
+			BIT(status, 1) ? "sync-bit " : "",
+			BIT(status, 2) ? "tx-empty " : "",
+			BIT(status, 3) ? "rx-empty " : "");
+	con.printf("start:  %s, %s\n", BIT(m_reg[REG_3_START], 0) ? "tx halted" : "tx enabled", BIT(m_reg[REG_3_START], 1) ? "2mbps" : "1mbps");
+	con.printf("irq:    %s (hold %u), txblock %u, txdelay %u, rxdelay %u\n",
+			(m_irq_state == ASSERT_LINE) ? "asserted" : "clear", m_irq_count, m_txblock, m_txdelay, m_rxdelay);
+}
+
+void namco_c139_device::debug_fifo()
+{
+	debugger_console &con = machine().debugger().console();
+
+	static const char *const STATE_NAMES[3] = { "closed", "connecting", "connected" };
+
+	unsigned const rx_state = std::min(m_context->rx_state(), 2U);
+	unsigned const tx_state = std::min(m_context->tx_state(), 2U);
+	con.printf("rx: %s, fifo %u bytes (max %u), queue %u frames (max %u, target %u)\n",
+			STATE_NAMES[rx_state], m_context->rx_used(), m_context->rx_high_water(), m_rxqueue_count, m_jitter.max_depth, m_jitter.target);
+	con.printf("tx: %s, fifo %u bytes (max %u)\n",
+			STATE_NAMES[tx_state], m_context->tx_used(), m_context->tx_high_water());
+	int const peer = m_context->peer_linkid();
+	if (peer >= 0)
+		con.printf("peer: link id %02x, %s\n", peer, m_context->compressed() ? "delta compressed" : "raw frames");
+	else
+		con.printf("peer: none (last rejected: %s)\n", m_context->reject_reason());
+}
+
+void namco_c139_device::debug_frames(unsigned count)
+{
+	debugger_console &con = machine().debugger().console();
+
+	count = std::min(count, m_history_count);
+	for (unsigned i = 0; i < count; i++)
+	{
+		const frame_record &rec = m_history[(m_history_wp + FRAME_HISTORY - 1 - i) % FRAME_HISTORY];
+		unsigned const size = rec.data[0x1ff];
+
+		unsigned sync = 0;
+		for (unsigned j = 0; j < size; j++)
+			if (BIT(rec.data[j * 2], 0))
+				sync++;
+
+		con.printf("%2u: %10u %s linkid=%02x size=%02x sync=%u\n", i, rec.ticks, rec.tx ? "tx" : "rx", rec.data[0x1fe], size, sync);
+	}
+}
+
+void namco_c139_device::debug_peek(unsigned index)
+{
+	debugger_console &con = machine().debugger().console();
+
+	if (index >= m_history_count)
+	{
+		con.printf("Only %u frames recorded\n", m_history_count);
+		return;
+	}
+
+	const frame_record &rec = m_history[(m_history_wp + FRAME_HISTORY - 1 - index) % FRAME_HISTORY];
+	unsigned const size = rec.data[0x1ff];
+	con.printf("%s linkid=%02x size=%02x\n", rec.tx ? "tx" : "rx", rec.data[0x1fe], size);
+	for (unsigned j = 0; j < size; j += 8)
+	{
+		std::string line = util::string_format("%02x |", j);
+		for (unsigned k = j; k < std::min(j + 8, size); k++)
+			line += util::string_format(" %03x", get_u16be(&rec.data[k * 2]));
+		con.printf("%s\n", line);
+	}
+}
+
+void namco_c139_device::debug_stats()
+{
+	debugger_console &con = machine().debugger().console();
+
+	auto const print_histogram =
+		[&con] (const char *name, const histogram &h)
+		{
+			if (h.count == 0)
+				con.printf("%-8s -\n", name);
+			else
+				con.printf("%-8s count=%u min=%u avg=%u max=%u\n", name, h.count, h.min, h.total / h.count, h.max);
+		};
+
+	con.printf("tx: %u frames, %u bytes, fifo max %u\n", m_stats.tx_frames, m_stats.tx_bytes, m_stats.tx_fifo_max);
+	con.printf("rx: %u frames, %u bytes, fifo max %u\n", m_stats.rx_frames, m_stats.rx_bytes, m_stats.rx_fifo_max);
+	con.printf("jitter buffer: depth=%u max=%u target=%u interval=%u jitter=%u drops=%u unpaced=%u\n",
+			m_jitter.depth, m_jitter.max_depth, m_jitter.target, m_jitter.interval, m_jitter.jitter, m_jitter.drops, m_jitter.unpaced);
+	print_histogram("latency", m_stats.latency);
+	print_histogram("tx time", m_stats.tx_time);
+	print_histogram("rx time", m_stats.rx_time);
+}
+
+void namco_c139_device::dump_stats()
+{
+	// nothing to report if the link was never used
+	if (m_stats.tx_frames == 0 && m_stats.rx_frames == 0)
+		return;
+
+	std::ofstream out(util::string_format("c139_%s.json", m_localport));
+	if (!out)
+		return;
+
+	auto const write_histogram =
+		[&out] (const char *name, const histogram &h)
+		{
+			util::stream_format(out, "\t\"%s\": { \"count\": %u, \"total\": %u, \"min\": %u, \"max\": %u, \"buckets\": [", name, h.count, h.total, h.min, h.max);
+			for (unsigned i = 0; i < std::size(h.buckets); i++)
+				util::stream_format(out, "%s%u", i ? ", " : "", h.buckets[i]);
+			out << "] }";
+		};
+
+	out << "{\n";
+	util::stream_format(out, "\t\"tag\": \"%s\",\n", tag());
+	util::stream_format(out, "\t\"linkid\": %u,\n", m_linkid);
+	util::stream_format(out, "\t\"tx_frames\": %u,\n", m_stats.tx_frames);
+	util::stream_format(out, "\t\"tx_bytes\": %u,\n", m_stats.tx_bytes);
+	util::stream_format(out, "\t\"rx_frames\": %u,\n", m_stats.rx_frames);
+	util::stream_format(out, "\t\"rx_bytes\": %u,\n", m_stats.rx_bytes);
+	util::stream_format(out, "\t\"tx_fifo_max\": %u,\n", m_stats.tx_fifo_max);
+	util::stream_format(out, "\t\"rx_fifo_max\": %u,\n", m_stats.rx_fifo_max);
+	util::stream_format(out, "\t\"jitter\": { \"max_depth\": %u, \"target\": %u, \"interval\": %u, \"jitter\": %u, \"drops\": %u, \"unpaced\": %u },\n",
+			m_jitter.max_depth, m_jitter.target, m_jitter.interval, m_jitter.jitter, m_jitter.drops, m_jitter.unpaced);
+	write_histogram("latency_usec", m_stats.latency);
+	out << ",\n";
+	write_histogram("tx_ticks", m_stats.tx_time);
+	out << ",\n";
+	write_histogram("rx_ticks", m_stats.rx_time);
+	out << "\n}\n";
 }
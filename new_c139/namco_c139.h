@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <fstream>
 
 
 
@@ -43,6 +44,47 @@ public:
 
 	void sci_de_hack(uint8_t data);
 
+	// rx jitter buffer statistics
+	struct jitter_stats
+	{
+		unsigned depth;         // frames currently queued
+		unsigned max_depth;     // queue high-water mark
+		unsigned target;        // adaptive target depth
+		uint32_t interval;      // smoothed inter-arrival time (12MHz ticks)
+		uint32_t jitter;        // smoothed inter-arrival jitter (12MHz ticks)
+		uint64_t frames;        // frames written to ram
+		uint64_t drops;         // stale frames discarded
+		uint64_t unpaced;       // frames written without the rx pacing delay to drain a backlog
+	};
+
+	const jitter_stats &rx_jitter_stats() const { return m_jitter; }
+
+	// link performance counters
+	struct histogram
+	{
+		uint64_t count;
+		uint64_t total;
+		uint64_t min;
+		uint64_t max;
+		uint64_t buckets[32];   // bucket n counts values below 2^n
+
+		void add(uint64_t value);
+	};
+
+	struct link_stats
+	{
+		uint64_t tx_frames;
+		uint64_t tx_bytes;
+		uint64_t rx_frames;
+		uint64_t rx_bytes;
+		unsigned tx_fifo_max;   // network fifo high-water marks (bytes)
+		unsigned rx_fifo_max;
+		histogram latency;      // one-way latency from sender timestamp (usec)
+		histogram tx_time;      // txsize write to wire (12MHz ticks)
+		histogram rx_time;      // wire to ram write (12MHz ticks)
+	};
+
+	const link_stats &stats() const { return m_stats; }
 
 protected:
 	// device-level overrides
@@ -54,6 +96,33 @@ protected:
 	devcb_write_line m_irq_cb;
 
 private:
+	static constexpr unsigned FRAME_SIZE = 0x208;
+	static constexpr unsigned FRAME_TIMESTAMP = 0x200;
+	static constexpr unsigned RX_QUEUE_SIZE = 16;
+	static constexpr unsigned RX_QUEUE_SLACK = 2;
+	static constexpr unsigned FRAME_HISTORY = 16;
+	static constexpr unsigned RING_MAX_NODES = 8;
+
+	// link impairment settings (usec, bytes/sec, percent)
+	struct fault_params
+	{
+		uint32_t latency = 0;
+		uint32_t jitter = 0;
+		uint32_t bandwidth = 0;
+		float loss = 0.0f;
+		float duplicate = 0.0f;
+		float reorder = 0.0f;
+
+		bool active() const { return latency || jitter || bandwidth || loss > 0.0f || duplicate > 0.0f || reorder > 0.0f; }
+	};
+
+	struct frame_record
+	{
+		uint64_t ticks;
+		bool tx;
+		uint8_t data[FRAME_SIZE];
+	};
+
 	uint16_t m_ram[0x2000];
 	uint16_t m_reg[0x0010];
 
@@ -67,11 +136,47 @@ private:
 	class context;
 	std::unique_ptr<context> m_context;
 
-	uint8_t m_buffer[0x200];
+	class fault;
+	fault_params m_fault_tx_params;
+	fault_params m_fault_rx_params;
+	std::unique_ptr<fault> m_fault_tx;
+	std::unique_ptr<fault> m_fault_rx;
+
+	uint8_t m_buffer[FRAME_SIZE];
+
+	uint8_t m_rxqueue[RX_QUEUE_SIZE][FRAME_SIZE];
+	uint64_t m_rxqueue_time[RX_QUEUE_SIZE];
+	unsigned m_rxqueue_rp;
+	unsigned m_rxqueue_count;
+	uint64_t m_rx_last_arrival;
+	jitter_stats m_jitter;
+	uint64_t m_ticks;
+
+	link_stats m_stats;
+	uint64_t m_tx_request;
+
+	frame_record m_history[FRAME_HISTORY];
+	unsigned m_history_wp;
+	unsigned m_history_count;
+
+	bool m_compress;
+	std::string m_capture_path;
+	std::string m_replay_path;
+	std::ofstream m_capture;
+	std::ifstream m_replay;
+	uint64_t m_replay_ticks;
+	uint8_t m_replay_frame[FRAME_SIZE];
 
 	uint8_t m_linkid;
 	bool m_forward;
 
+	uint8_t m_ring_node;
+	uint8_t m_ring_size;
+	uint16_t m_ring_baseport;
+	std::string m_ring_forward;
+	std::vector<std::string> m_ring_hosts;
+	bool m_ring_config;
+
 	int m_irq_state;
 	uint16_t m_irq_count;
 
@@ -81,12 +186,37 @@ private:
 
 	TIMER_CALLBACK_MEMBER(timer_12mhz_callback);
 
+	void ring_setup();
+	void update_linkid();
+
 	void comm_tick();
+	void queue_data(unsigned data_size);
 	void read_data(unsigned data_size);
-	unsigned read_frame(unsigned data_size);
+	void drop_stale_frame(const char *reason);
+	void write_frame(const uint8_t *frame);
+	unsigned read_frame(uint8_t *buffer, unsigned data_size);
+	unsigned read_transport(uint8_t *buffer, unsigned data_size);
 	unsigned find_sync_bit(unsigned tx_offset, unsigned tx_mask);
 	void send_data(unsigned data_size);
 	void send_frame(unsigned data_size);
+	void send_fault_frames(unsigned data_size);
+
+	void record_frame(bool tx, const uint8_t *frame);
+	void capture_frame(bool tx, const uint8_t *frame);
+	void replay_open();
+	bool replay_next();
+	unsigned replay_frame(uint8_t *buffer, unsigned data_size);
+
+	void config_load(config_type cfg_type, config_level cfg_level, util::xml::data_node const *parentnode);
+	void config_save(config_type cfg_type, util::xml::data_node *parentnode);
+
+	void debug_commands(const std::vector<std::string_view> &params);
+	void debug_status();
+	void debug_fifo();
+	void debug_frames(unsigned count);
+	void debug_peek(unsigned index);
+	void debug_stats();
+	void dump_stats();
 };
 
 
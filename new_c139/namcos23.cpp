@@ -1255,9 +1255,15 @@ It can also be used with Final Furlong when wired correctly.
 
 #include "md8412b.h"
 #include "namco_settings.h"
+#include "namcos23_span.h"
 #include "vpx3220a.h"
 
+#include <array>
+#include <atomic>
 #include <cfloat>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #define LOG_PROJ_MAT        (1ULL << 1)
 #define LOG_3D_STATE_ERR    (1ULL << 2)
@@ -1305,11 +1311,13 @@ It can also be used with Final Furlong when wired correctly.
 #define LOG_RS232           (1ULL << 44)
 #define LOG_IRQ_STATUS      (1ULL << 45)
 #define LOG_C451            (1ULL << 46)
+#define LOG_TEXCACHE        (1ULL << 47)
+#define LOG_DEFERRED        (1ULL << 48)
 #define LOG_ALL ( LOG_PROJ_MAT | LOG_3D_STATE_ERR | LOG_3D_STATE_UNK | LOG_VEC_ERR | LOG_VEC_UNK | LOG_RENDER_ERR | LOG_RENDER_INFO | LOG_MODEL_ERR | \
 				LOG_MODEL_INFO | LOG_MODELS | LOG_C435_PIO_UNK | LOG_C435_UNK | LOG_C417_UNK | LOG_C417_ACK | LOG_C412_UNK | LOG_C421_UNK | \
 				LOG_C422_IRQ | LOG_C422_UNK | LOG_C361_UNK | LOG_CTL_UNK | LOG_C417_IRQ | LOG_C361_IRQ | LOG_MATRIX_INFO | LOG_VEC_INFO | \
 				LOG_CTL_REG | LOG_C435_REG | LOG_C361_REG | LOG_C417_REG | LOG_C412_RAM | LOG_C421_RAM | LOG_C404_REGS | LOG_C404_RAM | LOG_GMEN | \
-				LOG_GENERAL | LOG_RS232 | LOG_IRQ_STATUS | LOG_C451 | LOG_MATRIX_UNK | LOG_VEC_UNK | LOG_MCU_PORTS )
+				LOG_GENERAL | LOG_RS232 | LOG_IRQ_STATUS | LOG_C451 | LOG_MATRIX_UNK | LOG_VEC_UNK | LOG_MCU_PORTS | LOG_TEXCACHE | LOG_DEFERRED )
 
 #define VERBOSE ( 0 )
 #include "logmacro.h"
@@ -1502,24 +1510,180 @@ struct namcos23_render_data
 
 	rgbaint_t fogcolor;
 	rgbaint_t fadecolor;
-	u32 (*texture_lookup)(running_machine &machine, const pen_t *pens, int penshift, int penmask, float x, float y, u8 &pen);
-	bool (*stencil_lookup)(running_machine &machine, float x, float y);
+	bool stencil_enabled;
+	bool depth_test;        // against the renderer's depth buffer
+	bool depth_write;
 };
 
 class namcos23_state;
+struct namcos23_poly_entry;
 
-class namcos23_renderer : public poly_manager<float, namcos23_render_data, 4>
+// Polygons are rasterized in screen tiles on the renderer's own work
+// queue (see render_flush), so only poly_manager's vertex and extent
+// types and its z clipper are used, not its queue.
+class namcos23_renderer
 {
+	using poly_base = poly_manager<float, namcos23_render_data, 4>;
+
 public:
+	using vertex_t = poly_base::vertex_t;
+	using extent_t = poly_base::extent_t;
+
 	namcos23_renderer(namcos23_state &state);
+	~namcos23_renderer();
 	void render_flush(screen_device &screen, bitmap_rgb32 &bitmap);
-	void render_scanline(s32 scanline, const extent_t& extent, const namcos23_render_data& object, int threadid);
+	template <int Kernel> void render_scanline(s32 scanline, const extent_t& extent, const namcos23_render_data& object, int threadid);
 	void render_sprite_scanline(s32 scanline, const extent_t& extent, const namcos23_render_data& object, int threadid);
-	float* zBuffer() { return m_zBuffer; }
+	float* zBuffer() { return m_zBuffer.get(); }
+
+	static int zclip_if_less(int numverts, const vertex_t *v, vertex_t *outv, float clipval) { return poly_base::zclip_if_less<4>(numverts, v, outv, clipval); }
+
+	// opt-in depth buffered drawing or deferred shading, see render_flush and render_bin
+	void set_depth_buffer(bool enable);
+	void set_deferred(bool enable) { m_deferred = enable; }
+
+	// perspective divide per subspan instead of per pixel, see namcos23_span::stepper
+	void set_subspans(bool enable) { m_subspans = enable; }
+
+	// deferred shading checked against the painter's order every frame, see verify_deferred
+	void set_verify(bool enable) { m_verify = enable; }
+
+	// pixels and priorities the two disagreed on and the osd ticks each took since the last call
+	void take_verify_stats(u64 &pixels, u64 &priorities, u64 &painter_ticks, u64 &deferred_ticks)
+	{
+		pixels = std::exchange(m_verify_pixels, 0);
+		priorities = std::exchange(m_verify_priorities, 0);
+		painter_ticks = std::exchange(m_verify_ticks[0], 0);
+		deferred_ticks = std::exchange(m_verify_ticks[1], 0);
+	}
+
+	// opaque pixels rasterized and shaded by the deferred path since the last call
+	void take_deferred_stats(u64 &rasterized, u64 &shaded) { rasterized = m_deferred_rasterized.exchange(0); shaded = m_deferred_shaded.exchange(0); }
+
+	// texels fetched and tile lookups they needed since the last call
+	void take_texture_stats(u64 &texels, u64 &tile_lookups) { texels = m_texels.exchange(0); tile_lookups = m_tile_lookups.exchange(0); }
 
 private:
+	// scanline kernels, one per combination of the per-polygon switches
+	enum
+	{
+		KERNEL_STENCIL = 1,
+		KERNEL_SHADE = 2,
+		KERNEL_POLYFADE = 4,
+		KERNEL_FADE = 8,
+		KERNEL_BLEND = 16,
+		KERNEL_ALPHA = 32,      // times 0 = off, 1 = every pixel, 2 = alpha pen only
+		KERNEL_DEPTH = 96,      // times 0 = 8bpp, 1 = 4bpp, 2 = 2bpp
+		KERNEL_COUNT = 288
+	};
+
+	using scanline_kernel = void (namcos23_renderer::*)(s32, const extent_t &, const namcos23_render_data &, int);
+
+	template <int... Kernel>
+	static constexpr std::array<scanline_kernel, sizeof...(Kernel)> make_scanline_kernels(std::integer_sequence<int, Kernel...>)
+	{
+		return { &namcos23_renderer::render_scanline<Kernel>... };
+	}
+
+	static int scanline_kernel_index(const namcos23_render_data &rd);
+
+	static const std::array<scanline_kernel, KERNEL_COUNT> s_scanline_kernels;
+
+	// render_flush bins triangles into BIN_SIZE square tiles of the screen
+	// and rasterizes the tiles in parallel. A tile draws its triangles in
+	// the sorted order and no two tiles share a pixel, so alpha and the
+	// painter's order come out as if drawn one polygon at a time.
+	static constexpr int BIN_SIZE = 32;
+	static constexpr int BINS_X = 640 / BIN_SIZE;
+	static constexpr int BINS_Y = 480 / BIN_SIZE;
+	static constexpr int BIN_COUNT = BINS_X * BINS_Y;
+
+	struct binned_polygon
+	{
+		scanline_kernel kernel;
+		const namcos23_render_data *rd;
+		bool opaque;            // replaces what is under it, see polygon_opaque
+	};
+
+	struct binned_triangle
+	{
+		scanline_kernel kernel;
+		const namcos23_render_data *rd;
+		u32 order;              // 1 + index into m_polygons
+		float x[3], y[3];       // sorted top to bottom
+		float dxdy[3];          // top to bottom, top to middle, middle to bottom
+		float p0[4];            // parameters at the top vertex
+		float dpdx[4], dpdy[4];
+		int miny, maxy;         // rows covered, maxy excluded
+	};
+
+	struct bin_job
+	{
+		namcos23_renderer *renderer;
+		int bin;
+	};
+
+	// deferred shading keeps one of these per pixel of the tile
+	struct visible_texel
+	{
+		u32 order;              // polygon on top, 0 for none
+		s32 tx, ty, shade;      // where it samples, as its kernel computed them
+	};
+
+	enum class vis_pass : u8
+	{
+		VISIBILITY,             // opaque polygons, only record what they cover
+		RESOLVE,                // shade the recorded texels of one polygon
+		OVERLAY                 // translucent polygons, only over what came before them
+	};
+
+	// handed to the scanline kernels in extent_t::userdata, drawing as usual without one
+	struct vis_context
+	{
+		vis_pass pass;
+		u32 order;
+		visible_texel *row;     // the tile's row, starting at x0
+		int x0;
+
+		visible_texel &texel(int x) const { return row[x - x0]; }
+	};
+
+	static bool polygon_opaque(const namcos23_render_data &rd) { return !rd.sprite && !rd.alpha && !rd.blend_enabled; }
+
+	void draw(bitmap_rgb32 &bitmap, bitmap_ind8 &primap);
+	void verify_deferred(bitmap_rgb32 &bitmap, bitmap_ind8 &primap);
+	void bin_polygon(namcos23_poly_entry &p, bitmap_rgb32 &bitmap, bitmap_ind8 &primap, bool depth_test, bool depth_write);
+	void bin_triangle(u32 order, const vertex_t &v1, const vertex_t &v2, const vertex_t &v3);
+	void render_bin(int bin, int threadid);
+	u32 render_bin_triangle(const binned_triangle &tri, int bin, int threadid, vis_pass pass, visible_texel *texels);
+	static void *bin_work(void *param, int threadid);
+
 	namcos23_state& m_state;
-	float* m_zBuffer = nullptr;
+	std::unique_ptr<float[]> m_zBuffer;     // 1/z per pixel, larger is nearer, only while depth buffering
+
+	std::vector<binned_polygon> m_polygons;
+	std::vector<binned_triangle> m_triangles;
+	std::vector<u32> m_bins[BIN_COUNT];
+	bin_job m_bin_jobs[BIN_COUNT];
+	osd_work_queue *m_bin_queue;
+	bool m_deferred = false;
+	bool m_subspans = false;        // perspective divide per subspan instead of per pixel
+	bool m_verify = false;
+
+	// the painter's order drawn next to deferred shading, only while verifying
+	bitmap_rgb32 m_verify_bitmap;
+	bitmap_ind8 m_verify_primap;
+	u64 m_verify_pixels = 0;
+	u64 m_verify_priorities = 0;
+	u64 m_verify_ticks[2] = { 0, 0 };
+
+	// only counted with LOG_DEFERRED
+	std::atomic<u64> m_deferred_rasterized{ 0 };
+	std::atomic<u64> m_deferred_shaded{ 0 };
+
+	// only counted with LOG_TEXCACHE
+	std::atomic<u64> m_texels{ 0 };
+	std::atomic<u64> m_tile_lookups{ 0 };
 };
 
 typedef namcos23_renderer::vertex_t poly_vertex;
@@ -1533,6 +1697,86 @@ struct namcos23_poly_entry
 	poly_vertex pv[16];
 };
 
+struct namcos23_poly_key
+{
+	u32 key;
+	u32 index;
+};
+
+// Texture tiles with their pens already looked up in one palette bank and
+// colour mode, so static scenery skips both the texel and the palette
+// read. Direct mapped, with a set of SLOTS per rasterizer thread so spans
+// never contend. A palette write bumps its bank's generation, which
+// retires every tile resolved from that bank and nothing else.
+class namcos23_rgb_tile_cache
+{
+public:
+	static constexpr unsigned SLOTS = 256;      // about 1KiB each, so 260KiB per rasterizing thread
+	static constexpr unsigned BANKS = 0x80;     // 256 pens each
+
+	void set_palette(const pen_t *pens) { m_pens = pens; }
+	void invalidate_bank(unsigned bank) { m_generation[bank % BANKS]++; }
+	void invalidate_all() { for (u32 &generation : m_generation) generation++; }
+
+	// the 16x16 colours of the tile at texels, pens already offset for the colour mode
+	const u32 *lookup(int threadid, u32 tile_offset, const u8 *texels, const pen_t *pens, int penshift, int penmask)
+	{
+		std::unique_ptr<thread_sets> &sets = m_threads[threadid];
+		if (!sets)
+			sets = std::make_unique<thread_sets>();
+
+		const u32 pen_offset = u32(pens - m_pens);
+		const u32 generation = m_generation[(pen_offset >> 8) % BANKS];
+		const u64 key = (u64(tile_offset) << 32) | (u64(pen_offset) << 16) | (penshift << 8) | penmask;
+		slot &entry = sets->slots[((tile_offset >> 8) ^ (pen_offset >> 4) ^ penshift) % SLOTS];
+		if (entry.key == key && entry.generation == generation)
+		{
+			sets->hits++;
+			return entry.colors;
+		}
+
+		sets->misses++;
+		entry.key = key;
+		entry.generation = generation;
+		for (int i = 0; i < 256; i++)
+			entry.colors[i] = pens[(texels[i] >> penshift) & penmask];
+		return entry.colors;
+	}
+
+	// only while no scanlines are running
+	void take_stats(u64 &hits, u64 &misses)
+	{
+		hits = misses = 0;
+		for (auto &sets : m_threads)
+		{
+			if (sets)
+			{
+				hits += std::exchange(sets->hits, 0);
+				misses += std::exchange(sets->misses, 0);
+			}
+		}
+	}
+
+private:
+	struct slot
+	{
+		u64 key = ~u64(0);
+		u32 generation = 0;
+		u32 colors[256];
+	};
+
+	struct thread_sets
+	{
+		slot slots[SLOTS];
+		u64 hits = 0;
+		u64 misses = 0;
+	};
+
+	const pen_t *m_pens = nullptr;
+	std::array<u32, BANKS> m_generation{ };
+	std::unique_ptr<thread_sets> m_threads[WORK_MAX_THREADS + 1];  // the thread waiting on the queue helps out as one more
+};
+
 
 struct c417_t
 {
@@ -1620,6 +1864,33 @@ struct c435_t
 	u16 spritedata[0x10000];
 };
 
+// A point ROM model decoded once into what the geometry stage needs, so
+// drawing an instance only transforms and lights. Vertices are kept as
+// structure of arrays; polygons keep their header words and where their
+// data sits in ROM, which the blend partner model is read with. The
+// pointer table and the point data are both ROM, so a compiled model
+// never goes stale and the cache is only ever added to.
+struct namcos23_model_poly
+{
+	u32 type;
+	u32 h;
+	u32 polyshift;
+	u32 offset;             // header, vertices and normals, in words from the model base
+	u32 vertex_offset;
+	u32 normal_offset;
+	u16 first;              // first vertex in the model's arrays
+	u8 ne;
+};
+
+struct namcos23_compiled_model
+{
+	std::vector<namcos23_model_poly> polys;
+	std::vector<s32> x, y, z;
+	std::vector<float> u, v;
+	std::vector<float> light;       // shade for lighting modes 0 to 2
+	std::vector<s32> nx, ny, nz;    // normal for lighting mode 3
+};
+
 struct render_t
 {
 	std::unique_ptr<namcos23_renderer> polymgr;
@@ -1629,6 +1900,7 @@ struct render_t
 	namcos23_render_entry entries[2][RENDER_MAX_ENTRIES];
 	namcos23_poly_entry polys[POLY_MAX_ENTRIES];
 	namcos23_poly_entry *poly_order[POLY_MAX_ENTRIES];
+	namcos23_poly_key poly_keys[2][POLY_MAX_ENTRIES];
 };
 
 class namcos23_state : public driver_device
@@ -1651,6 +1923,7 @@ public:
 		m_gfxdecode(*this, "gfxdecode"),
 		m_lightx(*this, "LIGHTX"),
 		m_lighty(*this, "LIGHTY"),
+		m_render_config(*this, "RENDER"),
 		m_p1(*this, "P1"),
 		m_p2(*this, "P2"),
 		m_screen(*this, "screen"),
@@ -1673,6 +1946,8 @@ public:
 	const u16 *m_texram;
 	u32 m_tileid_mask;
 	u32 m_tile_mask;
+	std::unique_ptr<u32[]> m_tile_offset;   // texrom offset of each tile id's 16x16 texels
+	namcos23_rgb_tile_cache m_rgb_tiles;
 
 	u16 *m_texture_tilemap;
 	u8 *m_texture_tiledata;
@@ -1681,6 +1956,7 @@ protected:
 	virtual void machine_start() override ATTR_COLD;
 	virtual void machine_reset() override ATTR_COLD;
 	virtual void video_start() override ATTR_COLD;
+	virtual void device_post_load() override;
 
 	void mips_base_map(address_map &map) ATTR_COLD;
 	void mips_map(address_map &map) ATTR_COLD;
@@ -1839,6 +2115,8 @@ protected:
 	void render_apply_matrot(s32 xi, s32 yi, s32 zi, const namcos23_render_entry *re, float &x, float &y, float &z);
 	void render_project(poly_vertex &v);
 	void render_model(const namcos23_render_entry *re);
+	const namcos23_compiled_model &compiled_model(u16 model, u32 adr);
+	void compile_model(namcos23_compiled_model &compiled, u32 adr);
 	void render_direct_poly(const namcos23_render_entry *re);
 	void render_sprite(const namcos23_render_entry *re);
 	void render_sprite_tile(u32 code_offset, const namcos23_render_entry *re, int row, int col);
@@ -1864,6 +2142,7 @@ protected:
 	required_device<gfxdecode_device> m_gfxdecode;
 	optional_ioport m_lightx;
 	optional_ioport m_lighty;
+	optional_ioport m_render_config;
 	required_ioport m_p1;
 	required_ioport m_p2;
 	required_device<screen_device> m_screen;
@@ -1892,6 +2171,7 @@ protected:
 
 	const u32 *m_ptrom;
 	u32 m_ptrom_limit;
+	std::unordered_map<u16, namcos23_compiled_model> m_models;
 
 	emu_timer *m_subcpu_scanline_on_timer;
 	emu_timer *m_subcpu_scanline_off_timer;
@@ -2201,9 +2481,25 @@ u16 namcos23_state::nthword(const u32 *pSource, int offs)
 ***************************************************************************/
 
 namcos23_renderer::namcos23_renderer(namcos23_state &state)
-	: poly_manager<float, namcos23_render_data, 4>(state.machine()),
-		m_state(state)
+	: m_state(state),
+		m_bin_queue(osd_work_queue_alloc(WORK_QUEUE_FLAG_MULTI))
 {
+	for (int bin = 0; bin < BIN_COUNT; bin++)
+		m_bin_jobs[bin] = bin_job{ this, bin };
+}
+
+namcos23_renderer::~namcos23_renderer()
+{
+	if (m_bin_queue)
+		osd_work_queue_free(m_bin_queue);
+}
+
+void namcos23_renderer::set_depth_buffer(bool enable)
+{
+	if (!enable)
+		m_zBuffer.reset();
+	else if (!m_zBuffer)
+		m_zBuffer = std::make_unique<float[]>(640 * 480);
 }
 
 // 3D hardware
@@ -3274,11 +3570,12 @@ void namcos23_renderer::render_sprite_scanline(s32 scanline, const extent_t& ext
 	u8 alpha_pen = object.poly_alpha_pen;
 	int fadefactor = 0xff - object.fadefactor;
 	rgbaint_t fadecolor(object.fadecolor);
+	const vis_context *const vis = static_cast<const vis_context *>(extent.userdata);
 
 	for (int x = extent.startx; x < extent.stopx; x++)
 	{
 		int pen = source[(int)x_index];
-		if (pen != 0xff)
+		if (pen != 0xff && (!vis || vis->order > vis->texel(x).order))
 		{
 			rgbaint_t rgb(pal[pen]);
 
@@ -3299,100 +3596,209 @@ void namcos23_renderer::render_sprite_scanline(s32 scanline, const extent_t& ext
 	}
 }
 
+const std::array<namcos23_renderer::scanline_kernel, namcos23_renderer::KERNEL_COUNT> namcos23_renderer::s_scanline_kernels =
+		namcos23_renderer::make_scanline_kernels(std::make_integer_sequence<int, namcos23_renderer::KERNEL_COUNT>());
+
+int namcos23_renderer::scanline_kernel_index(const namcos23_render_data &rd)
+{
+	int kernel = 0;
+	if (rd.stencil_enabled)
+		kernel |= KERNEL_STENCIL;
+	if (rd.shade_enabled)
+		kernel |= KERNEL_SHADE;
+	if (rd.pfade_enabled)
+		kernel |= KERNEL_POLYFADE;
+	if (rd.fadefactor != 0)
+		kernel |= KERNEL_FADE;
+	if (rd.blend_enabled)
+		kernel |= KERNEL_BLEND;
+	if (rd.alpha != 0)
+		kernel += KERNEL_ALPHA * (rd.alpha_enabled ? 1 : 2);
+	if (rd.cmode & 4)
+		kernel += KERNEL_DEPTH * 2;
+	else if (rd.cmode & 2)
+		kernel += KERNEL_DEPTH * 1;
+	return kernel;
+}
+
+template <int Kernel>
 void namcos23_renderer::render_scanline(s32 scanline, const extent_t& extent, const namcos23_render_data& object, int threadid)
 {
+	constexpr bool stencil_enabled = Kernel & KERNEL_STENCIL;
+	constexpr bool shade_enabled = Kernel & KERNEL_SHADE;
+	constexpr bool polyfade_enabled = Kernel & KERNEL_POLYFADE;
+	constexpr bool fade_enabled = Kernel & KERNEL_FADE;
+	constexpr bool blend_enabled = Kernel & KERNEL_BLEND;
+	constexpr int alpha_mode = (Kernel / KERNEL_ALPHA) % 3;
+	constexpr int depth = Kernel / KERNEL_DEPTH;
+	constexpr int penmask = (depth == 2) ? 0x03 : (depth == 1) ? 0x0f : 0xff;
+
 	const namcos23_render_data& rd = object;
 
-	float z = extent.param[0].start;
-	float u = extent.param[1].start;
-	float v = extent.param[2].start;
-	float i = extent.param[3].start;
-	const float dz = extent.param[0].dpdx;
-	const float du = extent.param[1].dpdx;
-	const float dv = extent.param[2].dpdx;
-	const float di = extent.param[3].dpdx;
-
-	int fadefactor = 0xff - rd.fadefactor;
-	int alphafactor = 0xff - rd.alpha;
-	bool alpha_enabled = rd.alpha_enabled;
-	u8 alpha_pen = rd.poly_alpha_pen;
-	bool polyfade_enabled = rd.pfade_enabled;
-	rgbaint_t fadecolor = rd.fadecolor;
-	rgbaint_t polycolor = rd.polycolor;
-	bool shade_enabled = rd.shade_enabled;
-	bool blend_enabled = rd.blend_enabled;
+	const float start[4] = { extent.param[0].start, extent.param[1].start, extent.param[2].start, extent.param[3].start };
+	const float dpdx[4] = { extent.param[0].dpdx, extent.param[1].dpdx, extent.param[2].dpdx, extent.param[3].dpdx };
+	const float dz = dpdx[0];
+	namcos23_span::stepper coords(start, dpdx, m_subspans);
+
+	namcos23_span::colour_state colours;
+	colours.poly_r = rd.polycolor.get_r32();
+	colours.poly_g = rd.polycolor.get_g32();
+	colours.poly_b = rd.polycolor.get_b32();
+	colours.fade_r = rd.fadecolor.get_r32();
+	colours.fade_g = rd.fadecolor.get_g32();
+	colours.fade_b = rd.fadecolor.get_b32();
+	colours.fadefactor = 0xff - rd.fadefactor;
+	colours.alphafactor = 0xff - rd.alpha;
+	colours.alpha_pen = rd.poly_alpha_pen;
 
 	u32 *dest = &rd.bitmap->pix(scanline);
 	u8 *primap = &rd.primap->pix(scanline);
 
 	const pen_t *pens = rd.pens;
 	int prioverchar = rd.prioverchar;
-	int penmask = 0xff;
 	int penshift = 0;
+	int tbase = rd.tbase;
 
-	if (rd.cmode & 4)
+	if constexpr (depth == 2)
 	{
 		pens += 0xec + ((rd.cmode & 8) << 1);
-		penmask = 0x03;
 		penshift = 2 * (~rd.cmode & 3);
 	}
-	else if (rd.cmode & 2)
+	else if constexpr (depth == 1)
 	{
 		pens += 0xe0 + ((rd.cmode & 8) << 1);
-		penmask = 0x0f;
 		penshift = 4 * (~rd.cmode & 1);
 	}
 
-	for (int x = extent.startx; x < extent.stopx; x++)
+	// the texture and stencil lookups, inlined from the state
+	const u16 *const texram = m_state.m_texram;
+	const u8 *const texrom = m_state.m_texrom;
+	const u32 *const tile_offset = m_state.m_tile_offset.get();
+	const u32 tileid_mask = m_state.m_tileid_mask;
+	namcos23_rgb_tile_cache &rgb_tiles = m_state.m_rgb_tiles;
+
+	float *const zbuffer = rd.depth_test ? &m_zBuffer[scanline * 640] : nullptr;
+	const bool depth_write = rd.depth_write;
+	const vis_context *const vis = static_cast<const vis_context *>(extent.userdata);
+
+	// the tile under the previous pixel, spans mostly stay in one
+	u32 cached_tileid = ~0U;
+	const u8 *tile = nullptr;
+	const u32 *tile_colors = nullptr;
+	u32 tile_lookups = 0;
+
+	// texture and shade coordinates of each pixel, exact or stepped in subspans
+	for (int x = extent.startx, length = 0; x < extent.stopx; x += length)
 	{
-		float ooz = 1.0f / z;
-		int tx = int(u * ooz);
-		int ty = int(v * ooz);
-		u8 pen = 0;
-		bool reject = rd.stencil_lookup(*rd.machine, tx, ty);
-		if (!reject)
+		length = std::min<int>(namcos23_span::LANES, extent.stopx - x);
+		const float zstart = coords.z();
+		int lane_tx[namcos23_span::LANES], lane_ty[namcos23_span::LANES], lane_shade[namcos23_span::LANES];
+		coords.step(length, lane_tx, lane_ty, lane_shade);
+
+		// early rejection, against the depth buffer where the z parameter
+		// is 1/z and linear on screen, or against the deferred visibility
+		bool keep[namcos23_span::LANES];
+		float lane_z[namcos23_span::LANES];
+		int kept = 0;
+		for (int n = 0; n < length; n++)
 		{
-			ty += rd.tbase;
-			u32 tex_rgb = rd.texture_lookup(*rd.machine, pens, penshift, penmask, tx, ty, pen);
-			rgbaint_t rgb(tex_rgb);
-
-			if (shade_enabled)
+			keep[n] = true;
+			if (zbuffer)
 			{
-				int shade = i * ooz;
-				rgb.scale_imm_and_clamp(shade << 2);
+				lane_z[n] = zstart + dz * n;
+				keep[n] = lane_z[n] > zbuffer[x + n];
 			}
+			if (vis && vis->pass == vis_pass::OVERLAY)
+				keep[n] = keep[n] && (vis->order > vis->texel(x + n).order);
+			kept += keep[n] ? 1 : 0;
+		}
+		if (!kept)
+			continue;
+
+		// fetch the subspan's texels, the lookups are gathers and stay scalar
+		s32 r[namcos23_span::LANES], g[namcos23_span::LANES], b[namcos23_span::LANES];
+		s32 shade[namcos23_span::LANES];
+		u8 pen[namcos23_span::LANES];
+		for (int n = 0; n < length; n++)
+		{
+			// rejected lanes only have to be defined
+			r[n] = g[n] = b[n] = shade[n] = 0;
+			pen[n] = 0;
+			if (!keep[n])
+				continue;
 
-			// fade
-			if (polyfade_enabled)
+			int tx = lane_tx[n];
+			int ty = lane_ty[n];
+			int texel_shade = lane_shade[n];
+
+			if (vis && vis->pass == vis_pass::RESOLVE)
 			{
-				rgb.scale_and_clamp(polycolor);
+				// sampled and stencil tested by the visibility pass
+				const visible_texel &texel = vis->texel(x + n);
+				tx = texel.tx;
+				ty = texel.ty;
+				texel_shade = texel.shade;
 			}
-
-			if (fadefactor != 0xff)
+			else if constexpr (stencil_enabled)
 			{
-				rgb.blend(fadecolor, fadefactor);
+				u32 xx = u32(tx);
+				u32 yy = u32(ty);
+				u32 bit = (xx & 15) ^ 15;
+				u32 offs = ((yy << 6) | (xx >> 4)) & 0x1ffff;
+				keep[n] = BIT(texram[offs], bit);
 			}
 
-			// alpha
-			if (alphafactor != 0xff && (alpha_enabled || pen == alpha_pen))
+			if (vis && vis->pass == vis_pass::VISIBILITY)
 			{
-				rgb.blend(rgbaint_t(dest[x]), alphafactor);
+				// shading waits for the resolve
+				if (keep[n])
+					vis->texel(x + n) = visible_texel{ vis->order, tx, ty, texel_shade };
+				continue;
 			}
 
-			if (blend_enabled)
+			// stencilled out texels are fetched too, they are simply never written
+			u32 xx = u32(tx);
+			u32 yy = u32(ty + tbase);
+			u32 tileid = ((xx >> 4) & 0xff) | ((yy << 4) & tileid_mask);
+			if (tileid != cached_tileid)
 			{
-				rgb.blend(rgbaint_t(dest[x]), 0x80);
+				cached_tileid = tileid;
+				tile = &texrom[tile_offset[tileid]];
+				tile_colors = rgb_tiles.lookup(threadid, tile_offset[tileid], tile, pens, penshift, penmask);
+				tile_lookups++;
 			}
+			const u32 texel = ((yy << 4) & 0xf0) | (xx & 0x0f);
+			if constexpr (alpha_mode == 2)
+				pen[n] = tile[texel];
+			const pen_t color = tile_colors[texel];
+			r[n] = (color >> 16) & 0xff;
+			g[n] = (color >> 8) & 0xff;
+			b[n] = color & 0xff;
+			shade[n] = texel_shade << 2;
+		}
+		if (vis && vis->pass == vis_pass::VISIBILITY)
+			continue;
 
-			u32 src = rgb.to_rgba();
-			dest[x] = 0xff000000 | src;
-			primap[x] = (primap[x] & ~1) | prioverchar;
+		namcos23_span::shade_lanes<shade_enabled, polyfade_enabled, fade_enabled, alpha_mode, blend_enabled>(colours, length, r, g, b, shade, pen, &dest[x]);
+
+		// write the kept lanes and their priority bits in one go
+		for (int n = 0; n < length; n++)
+		{
+			const u32 rgb = 0xff000000 | (r[n] << 16) | (g[n] << 8) | b[n];
+			dest[x + n] = keep[n] ? rgb : dest[x + n];
+			primap[x + n] = keep[n] ? ((primap[x + n] & ~1) | prioverchar) : primap[x + n];
+		}
+		if (zbuffer && depth_write)
+		{
+			for (int n = 0; n < length; n++)
+				zbuffer[x + n] = keep[n] ? lane_z[n] : zbuffer[x + n];
 		}
+	}
 
-		z += dz;
-		u += du;
-		v += dv;
-		i += di;
+	if constexpr ((VERBOSE & LOG_TEXCACHE) != 0)
+	{
+		m_texels += extent.stopx - extent.startx;
+		m_tile_lookups += tile_lookups;
 	}
 }
 
@@ -3427,45 +3833,6 @@ void namcos23_state::render_project(poly_vertex &pv)
 	pv.p[0] = 1.0f / pv.p[0];
 }
 
-static bool render_stencil_lookup(running_machine &machine, float x, float y)
-{
-	namcos23_state *state = machine.driver_data<namcos23_state>();
-	u32 xx = u32(x);
-	u32 yy = u32(y);
-	u32 bit = (xx & 15) ^ 15;
-	u32 offs = ((yy << 6) | (xx >> 4)) & 0x1ffff;
-	if (!BIT(state->m_texram[offs], bit))
-	{
-		return true;
-	}
-	return false;
-}
-
-static bool render_stencil_lookup_always(running_machine &machine, float x, float y)
-{
-	return false;
-}
-
-static u32 render_texture_lookup(running_machine &machine, const pen_t *pens, int penshift, int penmask, float x, float y, u8 &pen)
-{
-	namcos23_state *state = machine.driver_data<namcos23_state>();
-	u32 xx = u32(x);
-	u32 yy = u32(y);
-	u32 tileid = ((xx >> 4) & 0xff) | ((yy << 4) & state->m_tileid_mask);
-	u8 attr = state->m_tmhrom[tileid >> 1];
-	if(tileid & 1)
-		attr &= 15;
-	else
-		attr >>= 4;
-	u32 tile = (state->m_tmlrom[tileid] | (attr << 16)) & state->m_tile_mask;
-
-	// Probably swapx/swapy to add on bits 2-3 of attr
-	// Bits used by motoxgo at least
-	u8 color = state->m_texrom[(tile << 8) | ((yy << 4) & 0xf0) | (xx & 0x0f)];
-	pen = color;
-	return pens[(pen >> penshift) & penmask];
-}
-
 void namcos23_state::render_direct_poly(const namcos23_render_entry *re)
 {
 	render_t &render = m_render;
@@ -3513,8 +3880,7 @@ void namcos23_state::render_direct_poly(const namcos23_render_entry *re)
 
 		p->zkey = polyshift | (re->absolute_priority << 21);
 		p->rd.machine = &machine();
-		p->rd.texture_lookup = render_texture_lookup;
-		p->rd.stencil_lookup = render_stencil_lookup_always;
+		p->rd.stencil_enabled = false;
 		p->rd.pens = m_palette->pens() + (re->direct.d[2] & 0x7f00);
 		p->rd.direct = true;
 		p->rd.sprite = false;
@@ -3670,7 +4036,7 @@ void namcos23_state::render_immediate(const namcos23_render_entry *re)
 	namcos23_poly_entry *p = render.polys + render.poly_count;
 
 	// Should be unnecessary once frustum clipping happens correctly, but this will at least cull polys behind the camera
-	p->vertex_count = render.polymgr->zclip_if_less<4>(ne, pv, p->pv, 0.0001f);
+	p->vertex_count = render.polymgr->zclip_if_less(ne, pv, p->pv, 0.0001f);
 
 	// Project if you don't clip on the near plane
 	if (p->vertex_count >= 3)
@@ -3710,8 +4076,7 @@ void namcos23_state::render_immediate(const namcos23_render_entry *re)
 
 		p->zkey = zsort | (absolute_priority << 21);
 		p->rd.machine = &machine();
-		p->rd.texture_lookup = render_texture_lookup;
-		p->rd.stencil_lookup = stencil_enabled ? render_stencil_lookup : render_stencil_lookup_always;
+		p->rd.stencil_enabled = stencil_enabled;
 		p->rd.pens = m_palette->pens() + (re->immediate.pal & 0x7f00);
 		p->rd.rgb = 0x00ffffff;
 		p->rd.direct = false;
@@ -3744,6 +4109,98 @@ void namcos23_state::render_immediate(const namcos23_render_entry *re)
 	}
 }
 
+void namcos23_state::compile_model(namcos23_compiled_model &compiled, u32 adr)
+{
+	compiled = namcos23_compiled_model();
+
+	const u32 *data = &m_ptrom[adr];
+	u32 offs = 0;
+	while ((adr + offs) < m_ptrom_limit)
+	{
+		namcos23_model_poly poly;
+		poly.offset = offs;
+		poly.type = data[offs++];
+		poly.h = data[offs++];
+
+		const u32 type = poly.type;
+		const int lmode = (type >> 19) & 3;
+		const int ne = (type >> 8) & 15;
+		const bool stencil_enabled = BIT(poly.h, 11);
+
+		poly.polyshift = 0;
+		if (type & 0x00001000)
+		{
+			poly.polyshift = data[offs++];
+		}
+
+		u32 light = 0;
+		poly.normal_offset = offs;
+		if (lmode == 3)
+			offs += ne;
+		else
+			light = data[offs++];
+		poly.vertex_offset = offs;
+		offs += ne * 3;
+
+		// a polygon running off the end of the ROM is not drawn
+		if ((adr + offs) > m_ptrom_limit)
+			break;
+
+		// anything under a triangle is never drawn, but still ends the model
+		if (ne >= 3)
+		{
+			poly.first = compiled.x.size();
+			poly.ne = ne;
+			for (int i = 0; i < ne; i++)
+			{
+				const u32 v1 = data[poly.vertex_offset + i * 3 + 0];
+				const u32 v2 = data[poly.vertex_offset + i * 3 + 1];
+				const u32 v3 = data[poly.vertex_offset + i * 3 + 2];
+				compiled.x.push_back(u32_to_s24(v1));
+				compiled.y.push_back(u32_to_s24(v2));
+				compiled.z.push_back(u32_to_s24(v3));
+				compiled.u.push_back((((v1 >> 20) & 0xf00) | ((v2 >> 24) & 0xff)) + (stencil_enabled ? 0 : 0.5));
+				compiled.v.push_back((((v1 >> 16) & 0xf00) | ((v3 >> 24) & 0xff)) + (stencil_enabled ? 0 : 0.5));
+
+				static const u8 LIGHT_SHIFTS[4] = { 24, 16,  8,  0 };
+				if (lmode < 2)
+					compiled.light.push_back((i < 4) ? (float)((light >> LIGHT_SHIFTS[i]) & 0xff) : 0.f);
+				else
+					compiled.light.push_back(64.f);
+
+				s32 nx = 0, ny = 0, nz = 0;
+				if (lmode == 3)
+				{
+					const u32 norm = data[poly.normal_offset + i];
+					nx = u32_to_s10((norm >> 20) & 0x3ff);
+					ny = u32_to_s10((norm >> 10) & 0x3ff);
+					nz = u32_to_s10(norm & 0x3ff);
+				}
+				compiled.nx.push_back(nx);
+				compiled.ny.push_back(ny);
+				compiled.nz.push_back(nz);
+			}
+			compiled.polys.push_back(poly);
+		}
+
+		if (type & 0x00010000)
+			break;
+	}
+
+	LOGMASKED(LOG_MODEL_INFO, "%s: compiled model at %06x, %d polygons, %d vertices\n", machine().describe_context(), adr, int(compiled.polys.size()), int(compiled.x.size()));
+}
+
+const namcos23_compiled_model &namcos23_state::compiled_model(u16 model, u32 adr)
+{
+	auto const found = m_models.find(model);
+	if (found != m_models.end())
+		return found->second;
+
+	namcos23_compiled_model &compiled = m_models[model];
+	compile_model(compiled, adr);
+	return compiled;
+}
+
 void namcos23_state::render_model(const namcos23_render_entry *re)
 {
 	render_t &render = m_render;
@@ -3759,59 +4216,43 @@ void namcos23_state::render_model(const namcos23_render_entry *re)
 		return;
 	}
 
-	u32 offs = 0;
-	const u32 *data = &m_ptrom[adr];
+	const namcos23_compiled_model &model = compiled_model(re->model.model, adr);
 	const u32 *data2 = &m_ptrom[adr2];
-	while ((adr + offs) < m_ptrom_limit && (adr2 + offs) < m_ptrom_limit)
+	for (const namcos23_model_poly &poly : model.polys)
 	{
+		// the second model is read with this one's layout and may end first
+		if ((adr2 + poly.offset) >= m_ptrom_limit)
+			break;
+
 		poly_vertex pv[15];
 
-		u32 type = data[offs++];
-		u32 h    = data[offs++];
+		u32 type = poly.type;
+		u32 h    = poly.h;
 
 		u32 cmode = (type & 0x70000000) >> 29;
 		u32 tbase = (((type & 0x0f000000) >> 24) << 12) | (BIT(type, 31) << 16);
 		u8 color = (h >> 24) & 0x7f;
 		int lmode = (type >> 19) & 3;
-		int ne = (type >> 8) & 15;
+		int ne = poly.ne;
 		bool stencil_enabled = BIT(h, 11);
 
-		u32 polyshift = 0;
-		if (type & 0x00001000)
-		{
-			polyshift = data[offs++];
-		}
+		u32 polyshift = poly.polyshift;
 		u8 alpha = 0xff;
 
-		u32 light = 0;
-		u32 extptr = 0;
-
-		if (lmode == 3)
-		{
-			extptr = offs;
-			offs += ne;
-		}
-		else
-		{
-			light = data[offs++];
-		}
-
 		for (int i = 0; i < ne; i++)
 		{
-			u32 v1 = data[offs + 0];
-			u32 v2 = data[offs + 1];
-			u32 v3 = data[offs + 2];
+			const u32 vertex = poly.first + i;
 
 			float x, y, z;
-			render_apply_transform(u32_to_s24(v1), u32_to_s24(v2), u32_to_s24(v3), re, x, y, z);
+			render_apply_transform(model.x[vertex], model.y[vertex], model.z[vertex], re, x, y, z);
 
 			float factor_b = re->model_blend_factor / 16384.f;
 			float factor_a = 1.f - factor_b;
 			if (model_blend)
 			{
-				u32 v12 = data2[offs + 0];
-				u32 v22 = data2[offs + 1];
-				u32 v32 = data2[offs + 2];
+				u32 v12 = data2[poly.vertex_offset + i * 3 + 0];
+				u32 v22 = data2[poly.vertex_offset + i * 3 + 1];
+				u32 v32 = data2[poly.vertex_offset + i * 3 + 2];
 
 				float x2, y2, z2;
 				render_apply_transform(u32_to_s24(v12), u32_to_s24(v22), u32_to_s24(v32), re, x2, y2, z2);
@@ -3821,37 +4262,22 @@ void namcos23_state::render_model(const namcos23_render_entry *re)
 				z = z * factor_a + z2 * factor_b;
 			}
 
-			offs += 3;
-
 			pv[i].x = x;
 			pv[i].y = y;
 			pv[i].p[0] = z;
-			pv[i].p[1] = (((v1 >> 20) & 0xf00) | ((v2 >> 24) & 0xff)) + (stencil_enabled ? 0 : 0.5);
-			pv[i].p[2] = (((v1 >> 16) & 0xf00) | ((v3 >> 24) & 0xff)) + (stencil_enabled ? 0 : 0.5);
-			pv[i].p[3] = 64;
+			pv[i].p[1] = model.u[vertex];
+			pv[i].p[2] = model.v[vertex];
+			pv[i].p[3] = model.light[vertex];
 
-			static const u8 LIGHT_SHIFTS[4] = { 24, 16,  8,  0 };
-			switch (lmode)
+			if (lmode == 3)
 			{
-			case 0:
-				pv[i].p[3] = (float)((light >> LIGHT_SHIFTS[i]) & 0xff);
-				break;
-			case 1:
-				pv[i].p[3] = (float)((light >> LIGHT_SHIFTS[i]) & 0xff);
-				break;
-			case 2:
-				pv[i].p[3] = 64.f;
-				break;
-			case 3:
-			{
-				u32 norm = data[extptr];
-				s32 nx = u32_to_s10((norm >> 20) & 0x3ff);
-				s32 ny = u32_to_s10((norm >> 10) & 0x3ff);
-				s32 nz = u32_to_s10(norm & 0x3ff);
+				s32 nx = model.nx[vertex];
+				s32 ny = model.ny[vertex];
+				s32 nz = model.nz[vertex];
 
 				if (model_blend)
 				{
-					u32 norm2 = data2[extptr];
+					u32 norm2 = data2[poly.normal_offset + i];
 					s32 nx2 = u32_to_s10((norm2 >> 20) & 0x3ff);
 					s32 ny2 = u32_to_s10((norm2 >> 10) & 0x3ff);
 					s32 nz2 = u32_to_s10(norm2 & 0x3ff);
@@ -3860,7 +4286,6 @@ void namcos23_state::render_model(const namcos23_render_entry *re)
 					ny = (s32)(ny * factor_a + ny2 * factor_b);
 					nz = (s32)(nz * factor_a + nz2 * factor_b);
 				}
-				extptr++;
 
 				float nrx, nry, nrz;
 				render_apply_matrot(nx, ny, nz, re, nrx, nry, nrz);
@@ -3887,48 +4312,34 @@ void namcos23_state::render_model(const namcos23_render_entry *re)
 					lsi = 0;
 
 				pv[i].p[3] = std::clamp(re->camera_ambient + re->camera_power * lsi, 0.f, 64.f);
-			}   break;
 			}
 		}
 		namcos23_poly_entry *p = render.polys + render.poly_count;
 
-		if (ne >= 3)
+		if (BIT(h, 5))
 		{
-			if (BIT(h, 5))
-			{
-				const float z0 = pv[0].p[0];
-				const float z1 = pv[1].p[0];
-				const float z2 = pv[2].p[0];
-				const float z3 = pv[3].p[0];
-				float c1 =
-					(pv[2].x * (z0 * pv[1].y - pv[0].y * z1)) +
-					(pv[2].y * (pv[0].x * z1 - z0 * pv[1].x)) +
-					(z2 * (pv[0].y * pv[1].x - pv[0].x * pv[1].y));
-				float c2 =
-					(pv[0].x * (z2 * pv[3].y - pv[2].y * z3))+
-					(pv[0].y * (pv[2].x * z3 - z2 * pv[3].x))+
-					(z0 * (pv[2].y * pv[3].x - pv[2].x * pv[3].y));
-
-				if (c1 >= 0.f && c2 >= 0.f)
-				{
-					if (type & 0x00010000)
-						break;
-					continue;
-				}
-			}
-		}
-		else
-		{
-			if (type & 0x00010000)
-				break;
-			continue;
+			const float z0 = pv[0].p[0];
+			const float z1 = pv[1].p[0];
+			const float z2 = pv[2].p[0];
+			const float z3 = pv[3].p[0];
+			float c1 =
+				(pv[2].x * (z0 * pv[1].y - pv[0].y * z1)) +
+				(pv[2].y * (pv[0].x * z1 - z0 * pv[1].x)) +
+				(z2 * (pv[0].y * pv[1].x - pv[0].x * pv[1].y));
+			float c2 =
+				(pv[0].x * (z2 * pv[3].y - pv[2].y * z3))+
+				(pv[0].y * (pv[2].x * z3 - z2 * pv[3].x))+
+				(z0 * (pv[2].y * pv[3].x - pv[2].x * pv[3].y));
+
+			if (c1 >= 0.f && c2 >= 0.f)
+				continue;
 		}
 
 		float minz = FLT_MAX;
 		float maxz = FLT_MIN;
 
 		// Should be unnecessary once frustum clipping happens correctly, but this will at least cull polys behind the camera
-		p->vertex_count = render.polymgr->zclip_if_less<4>(ne, pv, p->pv, 0.0001f);
+		p->vertex_count = render.polymgr->zclip_if_less(ne, pv, p->pv, 0.0001f);
 
 		// Project if you don't clip on the near plane
 		if (p->vertex_count >= 3)
@@ -3955,11 +4366,7 @@ void namcos23_state::render_model(const namcos23_render_entry *re)
 			}
 
 			if (maxz < 0)
-			{
-				if (type & 0x00010000)
-					break;
 				continue;
-			}
 
 			int zsort = 0.5f * (minz + maxz) + 0.5f;
 			if (zsort > 0x1fffff) zsort = 0x1fffff;
@@ -3978,8 +4385,7 @@ void namcos23_state::render_model(const namcos23_render_entry *re)
 			p->zkey = zsort;
 
 			p->rd.machine = &machine();
-			p->rd.texture_lookup = render_texture_lookup;
-			p->rd.stencil_lookup = stencil_enabled ? render_stencil_lookup : render_stencil_lookup_always;
+			p->rd.stencil_enabled = stencil_enabled;
 			p->rd.pens = m_palette->pens() + (color << 8);
 			p->rd.rgb = (alpha << 24) | 0x00ffffff;
 			p->rd.model = re->model.model;
@@ -4018,55 +4424,359 @@ void namcos23_state::render_model(const namcos23_render_entry *re)
 
 			render.poly_count++;
 		}
+	}
+}
 
-		if (type & 0x000010000)
-			break;
+static void render_poly_sort(render_t &render)
+{
+	// Stable LSD radix sort, highest zkey first, over (key, index) pairs
+	// instead of pointers into the big entries. Keys are taken relative to
+	// the largest one, so out-of-range zsort sums still sort, and 8-bit
+	// digits above the spread of the keys are skipped.
+	const int count = render.poly_count;
+	int zmin = render.polys[0].zkey;
+	int zmax = zmin;
+	for (int i = 1; i < count; i++)
+	{
+		zmin = std::min(zmin, render.polys[i].zkey);
+		zmax = std::max(zmax, render.polys[i].zkey);
+	}
+
+	namcos23_poly_key *src = render.poly_keys[0];
+	namcos23_poly_key *dst = render.poly_keys[1];
+	for (int i = 0; i < count; i++)
+	{
+		src[i].key = u32(zmax) - u32(render.polys[i].zkey);
+		src[i].index = i;
+	}
+
+	const u32 spread = u32(zmax) - u32(zmin);
+	for (int shift = 0; shift < 32 && (spread >> shift); shift += 8)
+	{
+		u32 buckets[256] = { };
+		for (int i = 0; i < count; i++)
+			buckets[(src[i].key >> shift) & 0xff]++;
+
+		// nothing to do when every key has the same digit here
+		if (buckets[(src[0].key >> shift) & 0xff] == u32(count))
+			continue;
+
+		u32 offset = 0;
+		for (u32 &bucket : buckets)
+		{
+			const u32 size = bucket;
+			bucket = offset;
+			offset += size;
+		}
+
+		for (int i = 0; i < count; i++)
+			dst[buckets[(src[i].key >> shift) & 0xff]++] = src[i];
+		std::swap(src, dst);
 	}
+
+	for (int i = 0; i < count; i++)
+		render.poly_order[i] = &render.polys[src[i].index];
 }
 
-static int render_poly_compare(const void *i1, const void *i2)
+void namcos23_renderer::bin_triangle(u32 order, const vertex_t &v1, const vertex_t &v2, const vertex_t &v3)
 {
-	const namcos23_poly_entry *p1 = *(const namcos23_poly_entry **)i1;
-	const namcos23_poly_entry *p2 = *(const namcos23_poly_entry **)i2;
+	const vertex_t *v[3] = { &v1, &v2, &v3 };
+	if (v[0]->y > v[1]->y)
+		std::swap(v[0], v[1]);
+	if (v[1]->y > v[2]->y)
+		std::swap(v[1], v[2]);
+	if (v[0]->y > v[1]->y)
+		std::swap(v[0], v[1]);
+
+	// pixel centres at .5, a row or column is covered from round(edge) on
+	auto const round_clamped = [] (float value, int limit) { return int(std::clamp(floorf(value + 0.5f), 0.0f, float(limit))); };
+	const int miny = round_clamped(v[0]->y, 480);
+	const int maxy = round_clamped(v[2]->y, 480);
+	const int minx = round_clamped(std::min({ v1.x, v2.x, v3.x }), 640);
+	const int maxx = round_clamped(std::max({ v1.x, v2.x, v3.x }), 640);
+	if (miny >= maxy || minx >= maxx)
+		return;
 
-	return p1->zkey <= p2->zkey ? 1 : p1->zkey > p2->zkey ? -1 : 0;
+	const float dx1 = v[1]->x - v[0]->x, dy1 = v[1]->y - v[0]->y;
+	const float dx2 = v[2]->x - v[0]->x, dy2 = v[2]->y - v[0]->y;
+	const float det = dx1 * dy2 - dx2 * dy1;
+	if (det == 0.0f)
+		return;
+
+	binned_triangle &tri = m_triangles.emplace_back();
+	tri.kernel = m_polygons[order - 1].kernel;
+	tri.rd = m_polygons[order - 1].rd;
+	tri.order = order;
+	for (int n = 0; n < 3; n++)
+	{
+		tri.x[n] = v[n]->x;
+		tri.y[n] = v[n]->y;
+	}
+	for (int n = 0; n < 4; n++)
+	{
+		const float dp1 = v[1]->p[n] - v[0]->p[n];
+		const float dp2 = v[2]->p[n] - v[0]->p[n];
+		tri.p0[n] = v[0]->p[n];
+		tri.dpdx[n] = (dp1 * dy2 - dp2 * dy1) / det;
+		tri.dpdy[n] = (dp2 * dx1 - dp1 * dx2) / det;
+	}
+	tri.dxdy[0] = dx2 / dy2;
+	tri.dxdy[1] = (dy1 > 0.0f) ? dx1 / dy1 : 0.0f;
+	tri.dxdy[2] = (v[2]->y > v[1]->y) ? (v[2]->x - v[1]->x) / (v[2]->y - v[1]->y) : 0.0f;
+	tri.miny = miny;
+	tri.maxy = maxy;
+
+	const u32 index = m_triangles.size() - 1;
+	for (int by = miny / BIN_SIZE; by <= (maxy - 1) / BIN_SIZE; by++)
+		for (int bx = minx / BIN_SIZE; bx <= (maxx - 1) / BIN_SIZE; bx++)
+			m_bins[by * BINS_X + bx].push_back(index);
 }
 
-void namcos23_renderer::render_flush(screen_device &screen, bitmap_rgb32 &bitmap)
+u32 namcos23_renderer::render_bin_triangle(const binned_triangle &tri, int bin, int threadid, vis_pass pass, visible_texel *texels)
 {
-	render_t &render = m_state.m_render;
+	const int binx = (bin % BINS_X) * BIN_SIZE;
+	const int biny = (bin / BINS_X) * BIN_SIZE;
+	const int miny = std::max(tri.miny, biny);
+	const int maxy = std::min(tri.maxy, biny + BIN_SIZE);
 
-	if (!render.poly_count)
+	u32 pixels = 0;
+	for (int y = miny; y < maxy; y++)
+	{
+		// the long edge runs top to bottom, the short one changes at the middle vertex
+		const float fully = float(y) + 0.5f;
+		const float xlong = tri.x[0] + (fully - tri.y[0]) * tri.dxdy[0];
+		const float xshort = (fully < tri.y[1]) ? (tri.x[0] + (fully - tri.y[0]) * tri.dxdy[1]) : (tri.x[1] + (fully - tri.y[1]) * tri.dxdy[2]);
+
+		extent_t extent;
+		extent.startx = int(std::clamp(floorf(std::min(xlong, xshort) + 0.5f), float(binx), float(binx + BIN_SIZE)));
+		extent.stopx = int(std::clamp(floorf(std::max(xlong, xshort) + 0.5f), float(binx), float(binx + BIN_SIZE)));
+		if (extent.startx >= extent.stopx)
+			continue;
+
+		const float fullx = float(extent.startx) + 0.5f - tri.x[0];
+		for (int n = 0; n < 4; n++)
+		{
+			extent.param[n].start = tri.p0[n] + fullx * tri.dpdx[n] + (fully - tri.y[0]) * tri.dpdy[n];
+			extent.param[n].dpdx = tri.dpdx[n];
+		}
+
+		vis_context vis{ pass, tri.order, texels ? &texels[(y - biny) * BIN_SIZE] : nullptr, binx };
+		extent.userdata = texels ? &vis : nullptr;
+		(this->*tri.kernel)(y, extent, *tri.rd, threadid);
+		pixels += extent.stopx - extent.startx;
+	}
+	return pixels;
+}
+
+void namcos23_renderer::render_bin(int bin, int threadid)
+{
+	const int binx = (bin % BINS_X) * BIN_SIZE;
+	const int biny = (bin / BINS_X) * BIN_SIZE;
+
+	// each tile clears its own part of the depth buffer, nothing is nearer than 1/z = 0
+	if (m_zBuffer)
+	{
+		for (int y = biny; y < biny + BIN_SIZE; y++)
+			std::fill_n(&m_zBuffer[y * 640 + binx], BIN_SIZE, 0.0f);
+	}
+
+	if (!m_deferred)
+	{
+		for (const u32 index : m_bins[bin])
+			render_bin_triangle(m_triangles[index], bin, threadid, vis_pass::VISIBILITY, nullptr);
 		return;
+	}
+
+	// Deferred shading. An opaque pixel doesn't depend on what is under
+	// it, so only the last opaque polygon drawn at a pixel matters, along
+	// with the translucent ones drawn after it. Record that polygon and
+	// its texel for every pixel, shade each pixel once, then lay the
+	// later translucent polygons on top. The result is the painter's,
+	// bit for bit, the kernels and their interpolation being the same.
+	visible_texel texels[BIN_SIZE * BIN_SIZE];
+	for (visible_texel &texel : texels)
+		texel.order = 0;
+
+	u32 rasterized = 0;
+	for (const u32 index : m_bins[bin])
+	{
+		const binned_triangle &tri = m_triangles[index];
+		if (m_polygons[tri.order - 1].opaque)
+			rasterized += render_bin_triangle(tri, bin, threadid, vis_pass::VISIBILITY, texels);
+	}
+
+	// shade runs of pixels showing the same polygon
+	u32 shaded = 0;
+	for (int y = 0; y < BIN_SIZE; y++)
+	{
+		visible_texel *const row = &texels[y * BIN_SIZE];
+		for (int x = 0, end; x < BIN_SIZE; x = end)
+		{
+			const u32 order = row[x].order;
+			for (end = x + 1; end < BIN_SIZE && row[end].order == order; end++) { }
+			if (!order)
+				continue;
 
-	for (int i = 0; i < render.poly_count; i++)
-		render.poly_order[i] = &render.polys[i];
+			// the texels are recorded, the parameters only have to keep 1/z finite
+			const binned_polygon &poly = m_polygons[order - 1];
+			vis_context vis{ vis_pass::RESOLVE, order, row, binx };
+			extent_t extent;
+			extent.startx = binx + x;
+			extent.stopx = binx + end;
+			for (int n = 0; n < 4; n++)
+			{
+				extent.param[n].start = 1.0f;
+				extent.param[n].dpdx = 0.0f;
+			}
+			extent.userdata = &vis;
+			(this->*poly.kernel)(biny + y, extent, *poly.rd, threadid);
+			shaded += end - x;
+		}
+	}
 
-	qsort(render.poly_order, render.poly_count, sizeof(namcos23_poly_entry *), render_poly_compare);
+	for (const u32 index : m_bins[bin])
+	{
+		const binned_triangle &tri = m_triangles[index];
+		if (!m_polygons[tri.order - 1].opaque)
+			render_bin_triangle(tri, bin, threadid, vis_pass::OVERLAY, texels);
+	}
 
-	const static rectangle scissor(0, 639, 0, 479);
+	if constexpr ((VERBOSE & LOG_DEFERRED) != 0)
+	{
+		m_deferred_rasterized += rasterized;
+		m_deferred_shaded += shaded;
+	}
+}
+
+void *namcos23_renderer::bin_work(void *param, int threadid)
+{
+	const bin_job &job = *reinterpret_cast<const bin_job *>(param);
+	job.renderer->render_bin(job.bin, threadid);
+	return nullptr;
+}
+
+void namcos23_renderer::bin_polygon(namcos23_poly_entry &p, bitmap_rgb32 &bitmap, bitmap_ind8 &primap, bool depth_test, bool depth_write)
+{
+	p.rd.bitmap = &bitmap;
+	p.rd.primap = &primap;
+	p.rd.prioverchar = 2;
+	p.rd.depth_test = depth_test;
+	p.rd.depth_write = depth_write;
+
+	// the switches are constant for the polygon, so pick its kernel once here
+	binned_polygon &poly = m_polygons.emplace_back();
+	poly.kernel = p.rd.sprite ? &namcos23_renderer::render_sprite_scanline : s_scanline_kernels[scanline_kernel_index(p.rd)];
+	poly.rd = &p.rd;
+	poly.opaque = polygon_opaque(p.rd);
+	const u32 order = m_polygons.size();
+
+	// polygons are convex, so fan them out from the first vertex
+	const int vertex_count = p.rd.sprite ? 4 : p.vertex_count;
+	if (vertex_count >= 3 && vertex_count <= 6)
+	{
+		for (int v = 2; v < vertex_count; v++)
+			bin_triangle(order, p.pv[0], p.pv[v - 1], p.pv[v]);
+	}
+}
+
+void namcos23_renderer::draw(bitmap_rgb32 &bitmap, bitmap_ind8 &primap)
+{
+	render_t &render = m_state.m_render;
+
+	m_polygons.clear();
+	m_triangles.clear();
+	for (std::vector<u32> &bin : m_bins)
+		bin.clear();
+
+	if (m_zBuffer && !m_deferred)
+	{
+		// Opaque polygons first and front to back, so hidden pixels fail
+		// the depth test before they are textured. Translucent ones follow
+		// back to front, tested but not written. Sprites have no 1/z to
+		// test and stay in the painter's order on top.
+		for (int i = render.poly_count - 1; i >= 0; i--)
+		{
+			if (polygon_opaque(render.poly_order[i]->rd))
+				bin_polygon(*render.poly_order[i], bitmap, primap, true, true);
+		}
+		for (int i = 0; i < render.poly_count; i++)
+		{
+			if (!polygon_opaque(render.poly_order[i]->rd))
+				bin_polygon(*render.poly_order[i], bitmap, primap, !render.poly_order[i]->rd.sprite, false);
+		}
+	}
+	else
+	{
+		for (int i = 0; i < render.poly_count; i++)
+			bin_polygon(*render.poly_order[i], bitmap, primap, false, false);
+	}
+
+	// tiles are independent, so any idle thread can take the next one
+	int jobs = 0;
+	for (int bin = 0; bin < BIN_COUNT; bin++)
+	{
+		if (!m_bins[bin].empty())
+			m_bin_jobs[jobs++].bin = bin;
+	}
+
+	if (m_bin_queue && jobs)
+	{
+		osd_work_item_queue_multiple(m_bin_queue, bin_work, jobs, m_bin_jobs, sizeof(bin_job), WORK_ITEM_FLAG_AUTO_RELEASE);
+		osd_work_queue_wait(m_bin_queue, osd_ticks_per_second() * 10);
+	}
+	else
+	{
+		for (int n = 0; n < jobs; n++)
+			render_bin(m_bin_jobs[n].bin, 0);
+	}
+}
 
-	for (int i = 0; i < render.poly_count; i++)
+void namcos23_renderer::verify_deferred(bitmap_rgb32 &bitmap, bitmap_ind8 &primap)
+{
+	// the painter's order over a copy of the target first, it is what deferred shading has to match
+	if (m_verify_bitmap.width() < 640 || m_verify_bitmap.height() < 480)
 	{
-		const namcos23_poly_entry *p = render.poly_order[i];
-		namcos23_render_data& extra = render.polymgr->object_data().next();
-		extra = p->rd;
-		extra.bitmap = &bitmap;
-		extra.primap = &screen.priority();
-		extra.prioverchar = 2;
+		m_verify_bitmap.allocate(640, 480);
+		m_verify_primap.allocate(640, 480);
+	}
+	for (int y = 0; y < 480; y++)
+	{
+		std::copy_n(&bitmap.pix(y), 640, &m_verify_bitmap.pix(y));
+		std::copy_n(&primap.pix(y), 640, &m_verify_primap.pix(y));
+	}
 
-		// We should probably split the polygons into triangles ourselves to insure everything is being rendered properly
-		if (p->rd.sprite)
-			render_triangle_fan<4>(scissor, render_delegate(&namcos23_renderer::render_sprite_scanline, this), 4, p->pv);
-		else if (p->vertex_count == 3)
-			render_triangle<4>(scissor, render_delegate(&namcos23_renderer::render_scanline, this), p->pv[0], p->pv[1], p->pv[2]);
-		else if (p->vertex_count == 4)
-			render_triangle_fan<4>(scissor, render_delegate(&namcos23_renderer::render_scanline, this), 4, p->pv);
-		else if (p->vertex_count == 5)
-			render_triangle_fan<4>(scissor, render_delegate(&namcos23_renderer::render_scanline, this), 5, p->pv);
-		else if (p->vertex_count == 6)
-			render_triangle_fan<4>(scissor, render_delegate(&namcos23_renderer::render_scanline, this), 6, p->pv);
+	const osd_ticks_t start = osd_ticks();
+	m_deferred = false;
+	draw(m_verify_bitmap, m_verify_primap);
+	const osd_ticks_t painted = osd_ticks();
+	m_deferred = true;
+	draw(bitmap, primap);
+	m_verify_ticks[0] += painted - start;
+	m_verify_ticks[1] += osd_ticks() - painted;
+
+	for (int y = 0; y < 480; y++)
+	{
+		for (int x = 0; x < 640; x++)
+		{
+			m_verify_pixels += (bitmap.pix(y, x) != m_verify_bitmap.pix(y, x)) ? 1 : 0;
+			m_verify_priorities += (primap.pix(y, x) != m_verify_primap.pix(y, x)) ? 1 : 0;
+		}
 	}
+}
+
+void namcos23_renderer::render_flush(screen_device &screen, bitmap_rgb32 &bitmap)
+{
+	render_t &render = m_state.m_render;
+
+	if (!render.poly_count)
+		return;
+
+	render_poly_sort(render);
+
+	if (m_verify && m_deferred)
+		verify_deferred(bitmap, screen.priority());
+	else
+		draw(bitmap, screen.priority());
 
 	render.poly_count = 0;
 }
@@ -4182,8 +4892,42 @@ void namcos23_state::render_run(screen_device &screen, bitmap_rgb32 &bitmap)
 		re++;
 	}
 
+	const u32 config = m_render_config.read_safe(0);
+	const u32 hidden_surfaces = config & 3;
+	render.polymgr->set_depth_buffer(hidden_surfaces == 1);
+	render.polymgr->set_deferred(hidden_surfaces >= 2);
+	render.polymgr->set_verify(hidden_surfaces == 3);
+	render.polymgr->set_subspans(BIT(config, 2));
 	render.polymgr->render_flush(screen, bitmap);
-	render.polymgr->wait();
+
+	if (VERBOSE & LOG_TEXCACHE)
+	{
+		u64 texels, tile_lookups, hits, misses;
+		render.polymgr->take_texture_stats(texels, tile_lookups);
+		m_rgb_tiles.take_stats(hits, misses);
+		if (texels)
+			LOGMASKED(LOG_TEXCACHE, "%s: %d texels, %d tile lookups, %.1f%% served from the span's current tile\n", machine().describe_context(), texels, tile_lookups, 100.0 * double(texels - tile_lookups) / double(texels));
+		if (hits + misses)
+			LOGMASKED(LOG_TEXCACHE, "%s: RGB tiles %d hits, %d misses, %.1f%% hit rate\n", machine().describe_context(), hits, misses, 100.0 * double(hits) / double(hits + misses));
+	}
+
+	if (VERBOSE & LOG_DEFERRED)
+	{
+		u64 rasterized, shaded;
+		render.polymgr->take_deferred_stats(rasterized, shaded);
+		if (shaded)
+			LOGMASKED(LOG_DEFERRED, "%s: %d opaque pixels rasterized, %d shaded, overdraw %.2f\n", machine().describe_context(), rasterized, shaded, double(rasterized) / double(shaded));
+	}
+
+	if (hidden_surfaces == 3)
+	{
+		u64 pixels, priorities, painter_ticks, deferred_ticks;
+		render.polymgr->take_verify_stats(pixels, priorities, painter_ticks, deferred_ticks);
+		if (pixels || priorities)
+			logerror("%s: deferred shading differs from the polygon sort in %d pixels, %d priorities\n", machine().describe_context(), pixels, priorities);
+		LOGMASKED(LOG_DEFERRED, "%s: polygon sort %.2fms, deferred shading %.2fms\n", machine().describe_context(),
+				1000.0 * double(painter_ticks) / double(osd_ticks_per_second()), 1000.0 * double(deferred_ticks) / double(osd_ticks_per_second()));
+	}
 
 	render.cur = !render.cur;
 	render.count[render.cur] = 0;
@@ -4220,6 +4964,7 @@ void namcos23_state::paletteram_w(offs_t offset, u32 data, u32 mem_mask)
 		int g = nthbyte(m_generic_paletteram_32, which|0x10001);
 		int b = nthbyte(m_generic_paletteram_32, which|0x20001);
 		m_palette->set_pen_color(which/2, rgb_t(r,g,b));
+		m_rgb_tiles.invalidate_bank(which >> 9);
 	}
 }
 
@@ -4437,6 +5182,7 @@ void namcos23_state::video_start()
 	m_bgtilemap->set_scroll_rows(64 * 16); // fake
 	m_bgtilemap->set_transparent_pen(0xf);
 	m_render.polymgr = std::make_unique<namcos23_renderer>(*this);
+	m_rgb_tiles.set_palette(m_palette->pens());
 
 	m_ptrom  = (const u32 *)memregion("pointrom")->base();
 	m_tmlrom = (const u16 *)memregion("textilemapl")->base();
@@ -4445,6 +5191,19 @@ void namcos23_state::video_start()
 
 	m_tileid_mask = (memregion("textilemapl")->bytes()/2 - 1) & ~0xff; // Used for y masking
 	m_tile_mask = memregion("textile")->bytes()/256 - 1;
+
+	// the tile maps are ROM, so resolve every tile id once instead of per texel
+	const u32 tileids = memregion("textilemapl")->bytes()/2;
+	m_tile_offset = std::make_unique<u32[]>(tileids);
+	for (u32 tileid = 0; tileid < tileids; tileid++)
+	{
+		u8 attr = m_tmhrom[tileid >> 1];
+		if (tileid & 1)
+			attr &= 15;
+		else
+			attr >>= 4;
+		m_tile_offset[tileid] = ((m_tmlrom[tileid] | (attr << 16)) & m_tile_mask) << 8;
+	}
 	m_ptrom_limit = memregion("pointrom")->bytes()/4;
 
 	for (int i = 0; i < m_gfxdecode->gfx(1)->elements(); i++)
@@ -4454,6 +5213,12 @@ void namcos23_state::video_start()
 	m_texture_tiledata = (u8 *)m_gfxdecode->gfx(1)->get_data(0);
 }
 
+void namcos23_state::device_post_load()
+{
+	// the palette came back without going through paletteram_w
+	m_rgb_tiles.invalidate_all();
+}
+
 void gorgon_state::video_start()
 {
 	namcos23_state::video_start();
@@ -6485,6 +7250,18 @@ static INPUT_PORTS_START(s23)
 
 	PORT_START("JVS_SCREEN_POSITION_INPUT_Y1")
 	PORT_BIT(0xffff, 0x0000, IPT_UNUSED)
+
+	// not hardware; the depth buffer trades the polygon sort's exact look
+	// for less overdraw, deferred shading looks the same and shades less
+	PORT_START("RENDER")
+	PORT_CONFNAME(0x03, 0x00, "Hidden Surfaces")
+	PORT_CONFSETTING(0x00, "Polygon Sort")
+	PORT_CONFSETTING(0x01, "Depth Buffer")
+	PORT_CONFSETTING(0x02, "Deferred Shading")
+	PORT_CONFSETTING(0x03, "Deferred Shading (verify)")    // also draws the polygon sort and logs any difference
+	PORT_CONFNAME(0x04, 0x00, "Perspective")              // see tools/s23span_test.sh for the subspan error
+	PORT_CONFSETTING(0x00, "Exact")
+	PORT_CONFSETTING(0x04, "Subspans (faster)")
 INPUT_PORTS_END
 
 static INPUT_PORTS_START(gorgon)
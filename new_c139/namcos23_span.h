@@ -0,0 +1,187 @@
+// license:BSD-3-Clause
+// copyright-holders:R. Belmont, Ryan Holtz, Phil Stroffolino, Olivier Galibert
+/***************************************************************************
+
+    Namco System 23 scanline helpers
+
+    The perspective stepping and colour arithmetic of the renderer's
+    scanline kernels, kept free of emulator state so
+    tools/s23span_test.cpp can hold them against the per-pixel loop and
+    rgbaint_t code they replaced. Needs the MAME integer types.
+
+***************************************************************************/
+#ifndef MAME_NAMCO_NAMCOS23_SPAN_H
+#define MAME_NAMCO_NAMCOS23_SPAN_H
+
+#pragma once
+
+#include <algorithm>
+#include <utility>
+
+
+namespace namcos23_span {
+
+// pixels the scanline kernels handle per step
+constexpr int LANES = 16;
+
+// Texture and shade coordinates along a span, from the z, u, v and i
+// parameters (1/z and u, v, i over z, all linear on screen).
+//
+// The exact mode divides at every pixel and steps the parameters one pixel
+// at a time, the same float operations in the same order as the original
+// per-pixel loop, so it samples the same texels. The subspan mode divides
+// only at the ends of each run of LANES pixels and steps the coordinates
+// linearly in 16.16 between them. Both ends are exact, so the error peaks
+// mid-run; tools/s23span_test.cpp measures it.
+class stepper
+{
+public:
+	stepper(const float *start, const float *dpdx, bool subspans)
+		: m_z(start[0]), m_u(start[1]), m_v(start[2]), m_i(start[3])
+		, m_dz(dpdx[0]), m_du(dpdx[1]), m_dv(dpdx[2]), m_di(dpdx[3])
+		, m_subspans(subspans)
+	{
+		if (m_subspans)
+		{
+			const float ooz = 1.0f / m_z;
+			m_tu = s64(m_u * ooz * 65536.0f);
+			m_tv = s64(m_v * ooz * 65536.0f);
+			m_ti = s64(m_i * ooz * 65536.0f);
+		}
+	}
+
+	// z parameter of the next pixel
+	float z() const { return m_z; }
+
+	// coordinates of the next length pixels, at most LANES
+	void step(int length, int *tx, int *ty, int *shade)
+	{
+		if (!m_subspans)
+		{
+			for (int n = 0; n < length; n++)
+			{
+				const float ooz = 1.0f / m_z;
+				tx[n] = int(m_u * ooz);
+				ty[n] = int(m_v * ooz);
+				shade[n] = int(m_i * ooz);
+				m_z += m_dz;
+				m_u += m_du;
+				m_v += m_dv;
+				m_i += m_di;
+			}
+			return;
+		}
+
+		m_z += m_dz * length;
+		m_u += m_du * length;
+		m_v += m_dv * length;
+		m_i += m_di * length;
+		const float ooz = 1.0f / m_z;
+		const s64 tu_end = s64(m_u * ooz * 65536.0f);
+		const s64 tv_end = s64(m_v * ooz * 65536.0f);
+		const s64 ti_end = s64(m_i * ooz * 65536.0f);
+		const s64 dtu = (tu_end - m_tu) / length;
+		const s64 dtv = (tv_end - m_tv) / length;
+		const s64 dti = (ti_end - m_ti) / length;
+		const s64 tu = std::exchange(m_tu, tu_end);
+		const s64 tv = std::exchange(m_tv, tv_end);
+		const s64 ti = std::exchange(m_ti, ti_end);
+
+		// truncate towards zero like the float to int conversion
+		for (int n = 0; n < length; n++)
+		{
+			tx[n] = int((tu + dtu * n) / 65536);
+			ty[n] = int((tv + dtv * n) / 65536);
+			shade[n] = int((ti + dti * n) / 65536);
+		}
+	}
+
+private:
+	float m_z, m_u, m_v, m_i;
+	const float m_dz, m_du, m_dv, m_di;
+	const bool m_subspans;
+	s64 m_tu = 0, m_tv = 0, m_ti = 0;
+};
+
+
+// what the colour stages need from the polygon
+struct colour_state
+{
+	s32 poly_r, poly_g, poly_b;     // polygon fade colour
+	s32 fade_r, fade_g, fade_b;     // screen fade colour
+	s32 fadefactor;                 // weight of the texel against the fade colour
+	s32 alphafactor;                // weight of the texel against what is under it
+	u8 alpha_pen;                   // the only pen alpha applies to in alpha mode 2
+};
+
+// The shade, fade, alpha and blend stages for up to LANES pixels, channel
+// by channel so each loop vectorises. Same arithmetic as rgbaint_t's
+// scale_imm_and_clamp, scale_and_clamp and blend on one pixel at a time.
+// Alpha mode 0 is off, 1 applies to every pixel, 2 only to alpha_pen.
+// shade is in 1/256, under holds the pixels being drawn over.
+template <bool Shade, bool PolyFade, bool Fade, int AlphaMode, bool Blend>
+inline void shade_lanes(const colour_state &cs, int length, s32 *r, s32 *g, s32 *b, const s32 *shade, const u8 *pen, const u32 *under)
+{
+	auto const clamp_lane = [] (s32 value) { return std::clamp<s32>(value, 0, 0xff); };
+	auto const blend_lane = [] (s32 value, s32 other, s32 factor) { return (value * factor + other * (0x100 - factor)) >> 8; };
+
+	if constexpr (Shade)
+	{
+		for (int n = 0; n < length; n++)
+		{
+			r[n] = clamp_lane((r[n] * shade[n]) >> 8);
+			g[n] = clamp_lane((g[n] * shade[n]) >> 8);
+			b[n] = clamp_lane((b[n] * shade[n]) >> 8);
+		}
+	}
+
+	if constexpr (PolyFade)
+	{
+		for (int n = 0; n < length; n++)
+		{
+			r[n] = clamp_lane((r[n] * cs.poly_r) >> 8);
+			g[n] = clamp_lane((g[n] * cs.poly_g) >> 8);
+			b[n] = clamp_lane((b[n] * cs.poly_b) >> 8);
+		}
+	}
+
+	if constexpr (Fade)
+	{
+		for (int n = 0; n < length; n++)
+		{
+			r[n] = blend_lane(r[n], cs.fade_r, cs.fadefactor);
+			g[n] = blend_lane(g[n], cs.fade_g, cs.fadefactor);
+			b[n] = blend_lane(b[n], cs.fade_b, cs.fadefactor);
+		}
+	}
+
+	// alpha and 50% blend both read the pixel before this polygon
+	if constexpr (AlphaMode != 0 || Blend)
+	{
+		for (int n = 0; n < length; n++)
+		{
+			const s32 under_r = (under[n] >> 16) & 0xff;
+			const s32 under_g = (under[n] >> 8) & 0xff;
+			const s32 under_b = under[n] & 0xff;
+
+			if constexpr (AlphaMode != 0)
+			{
+				const bool apply = (AlphaMode == 1) || (pen[n] == cs.alpha_pen);
+				r[n] = apply ? blend_lane(r[n], under_r, cs.alphafactor) : r[n];
+				g[n] = apply ? blend_lane(g[n], under_g, cs.alphafactor) : g[n];
+				b[n] = apply ? blend_lane(b[n], under_b, cs.alphafactor) : b[n];
+			}
+
+			if constexpr (Blend)
+			{
+				r[n] = blend_lane(r[n], under_r, 0x80);
+				g[n] = blend_lane(g[n], under_g, 0x80);
+				b[n] = blend_lane(b[n], under_b, 0x80);
+			}
+		}
+	}
+}
+
+} // namespace namcos23_span
+
+#endif // MAME_NAMCO_NAMCOS23_SPAN_H
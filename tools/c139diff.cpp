@@ -0,0 +1,340 @@
+// license:BSD-3-Clause
+// copyright-holders:Ariane Fugmann
+/***************************************************************************
+
+    c139diff - compare two C139 benchmark trace logs
+
+    Usage: c139diff [-t ticks] [-x] <a.log> <b.log>
+
+    The logs are written by the c139bench driver with "Trace" enabled,
+    typically once built against old_c139/ and once against new_c139/.
+    Record types:
+
+    H <impl> <mode> <nodes>             header
+    I <node> <ticks> <state>            irq edge at 12MHz tick
+    R <node> <frame> <hash> <status>    ram hash once the link is idle
+    X <node> <ticks> <hash> <rxoffset>  rx area hash on each irq
+    S <node> <what> <offset> <actual> <expected>
+                                        scenario expectation not met
+    C <emulated> <cpu>                  emulated and cpu seconds
+
+    irq edges may drift by up to -t ticks before they count as a
+    difference. The bench links its nodes over loopback TCP, so when a
+    frame lands depends on the network thread and two runs of the same
+    build never agree to the tick. The default of 200000 ticks is one
+    60Hz host frame: an edge may move within the frame it belongs to,
+    but edge count, order and state must match. -t 0 compares exactly.
+
+    The bench only writes R records after holding the hosts until no
+    frame is in flight, so those are compared exactly, and a point where
+    the link never went quiet ("unsettled") is always a difference. What
+    an X record sees depends on how many frames had landed by that irq,
+    so only their count is compared unless -x asks for the hashes too.
+    Exit status is 0 when the logs match, 1 when they differ and 2 on
+    errors.
+
+***************************************************************************/
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+struct irq_edge
+{
+	uint64_t ticks;
+	int state;
+};
+
+struct ram_state
+{
+	uint32_t frame;
+	std::string hash;
+	std::string status;
+};
+
+struct rx_state
+{
+	uint64_t ticks;
+	std::string hash;
+	std::string offset;
+};
+
+struct trace
+{
+	std::string impl = "?";
+	std::string mode = "?";
+	std::map<unsigned, std::vector<irq_edge>> irqs;
+	std::map<unsigned, std::vector<ram_state>> rams;
+	std::map<unsigned, std::vector<rx_state>> rxs;
+	unsigned mismatches = 0;
+	double emulated = 0.0;
+	double cpu = 0.0;
+};
+
+bool load(const char *path, trace &result)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::fprintf(stderr, "c139diff: cannot open %s\n", path);
+		return false;
+	}
+
+	std::string line;
+	unsigned lineno = 0;
+	while (std::getline(file, line))
+	{
+		lineno++;
+		std::istringstream fields(line);
+		char type = 0;
+		fields >> type;
+
+		bool ok = true;
+		switch (type)
+		{
+			case 'H':
+			{
+				unsigned nodes;
+				ok = bool(fields >> result.impl >> result.mode >> nodes);
+				break;
+			}
+
+			case 'I':
+			{
+				unsigned node;
+				irq_edge edge;
+				ok = bool(fields >> node >> edge.ticks >> edge.state);
+				if (ok)
+					result.irqs[node].push_back(edge);
+				break;
+			}
+
+			case 'R':
+			{
+				unsigned node;
+				ram_state ram;
+				ok = bool(fields >> node >> ram.frame >> ram.hash >> ram.status);
+				if (ok)
+					result.rams[node].push_back(ram);
+				break;
+			}
+
+			case 'X':
+			{
+				unsigned node;
+				rx_state rx;
+				ok = bool(fields >> node >> rx.ticks >> rx.hash >> rx.offset);
+				if (ok)
+					result.rxs[node].push_back(rx);
+				break;
+			}
+
+			case 'S':
+				result.mismatches++;
+				break;
+
+			case 'C':
+				ok = bool(fields >> result.emulated >> result.cpu);
+				break;
+
+			case 0:
+				break;
+
+			default:
+				ok = false;
+				break;
+		}
+
+		if (!ok)
+		{
+			std::fprintf(stderr, "c139diff: %s:%u: malformed record\n", path, lineno);
+			return false;
+		}
+	}
+	return true;
+}
+
+// only the first few differences per node are interesting, the rest usually follow from them
+constexpr unsigned MAX_REPORTS = 5;
+
+unsigned diff_irqs(const trace &a, const trace &b, uint64_t tolerance)
+{
+	unsigned diffs = 0;
+	for (auto const &[node, edges_a] : a.irqs)
+	{
+		auto const it = b.irqs.find(node);
+		std::vector<irq_edge> const empty;
+		std::vector<irq_edge> const &edges_b = (it != b.irqs.end()) ? it->second : empty;
+
+		size_t const count = std::min(edges_a.size(), edges_b.size());
+		unsigned reported = 0;
+		uint64_t max_drift = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			uint64_t const drift = (edges_a[i].ticks > edges_b[i].ticks) ? (edges_a[i].ticks - edges_b[i].ticks) : (edges_b[i].ticks - edges_a[i].ticks);
+			max_drift = std::max(max_drift, drift);
+			if (edges_a[i].state != edges_b[i].state || drift > tolerance)
+			{
+				if (reported++ < MAX_REPORTS)
+					std::printf("irq  node %u edge %zu: %" PRIu64 "/%d vs %" PRIu64 "/%d\n",
+							node, i, edges_a[i].ticks, edges_a[i].state, edges_b[i].ticks, edges_b[i].state);
+				diffs++;
+			}
+		}
+		if (edges_a.size() != edges_b.size())
+		{
+			std::printf("irq  node %u: %zu vs %zu edges\n", node, edges_a.size(), edges_b.size());
+			diffs++;
+		}
+		std::printf("irq  node %u: max drift %" PRIu64 " ticks\n", node, max_drift);
+	}
+	return diffs;
+}
+
+unsigned diff_rams(const trace &a, const trace &b)
+{
+	unsigned diffs = 0;
+	for (auto const &[node, rams_a] : a.rams)
+	{
+		auto const it = b.rams.find(node);
+		if (it == b.rams.end())
+		{
+			std::printf("ram  node %u: missing from second log\n", node);
+			diffs++;
+			continue;
+		}
+		std::vector<ram_state> const &rams_b = it->second;
+
+		size_t const count = std::min(rams_a.size(), rams_b.size());
+		unsigned reported = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			bool const unsettled = rams_a[i].hash == "unsettled" || rams_b[i].hash == "unsettled";
+			if (unsettled || rams_a[i].frame != rams_b[i].frame || rams_a[i].hash != rams_b[i].hash || rams_a[i].status != rams_b[i].status)
+			{
+				if (reported++ < MAX_REPORTS)
+					std::printf("ram  node %u frame %u: %s/%s vs frame %u: %s/%s\n",
+							node, rams_a[i].frame, rams_a[i].hash.c_str(), rams_a[i].status.c_str(), rams_b[i].frame, rams_b[i].hash.c_str(), rams_b[i].status.c_str());
+				diffs++;
+			}
+		}
+		if (rams_a.size() != rams_b.size())
+		{
+			std::printf("ram  node %u: %zu vs %zu settle points\n", node, rams_a.size(), rams_b.size());
+			diffs++;
+		}
+	}
+	return diffs;
+}
+
+unsigned diff_rxs(const trace &a, const trace &b, bool hashes)
+{
+	unsigned diffs = 0;
+	for (auto const &[node, rxs_a] : a.rxs)
+	{
+		auto const it = b.rxs.find(node);
+		if (it == b.rxs.end())
+		{
+			std::printf("rx   node %u: missing from second log\n", node);
+			diffs++;
+			continue;
+		}
+		std::vector<rx_state> const &rxs_b = it->second;
+
+		size_t const count = std::min(rxs_a.size(), rxs_b.size());
+		unsigned reported = 0;
+		for (size_t i = 0; hashes && i < count; i++)
+		{
+			if (rxs_a[i].hash != rxs_b[i].hash || rxs_a[i].offset != rxs_b[i].offset)
+			{
+				if (reported++ < MAX_REPORTS)
+					std::printf("rx   node %u irq %zu: %s/%s vs %s/%s\n",
+							node, i, rxs_a[i].hash.c_str(), rxs_a[i].offset.c_str(), rxs_b[i].hash.c_str(), rxs_b[i].offset.c_str());
+				diffs++;
+			}
+		}
+		if (rxs_a.size() != rxs_b.size())
+		{
+			std::printf("rx   node %u: %zu vs %zu interrupts\n", node, rxs_a.size(), rxs_b.size());
+			diffs++;
+		}
+	}
+	return diffs;
+}
+
+void report_cost(const char *path, const trace &t)
+{
+	if (t.emulated > 0.0)
+		std::printf("cost %s (%s, mode %s): %.1f ms cpu per emulated second\n", path, t.impl.c_str(), t.mode.c_str(), t.cpu * 1000.0 / t.emulated);
+	else
+		std::printf("cost %s (%s, mode %s): no timing record\n", path, t.impl.c_str(), t.mode.c_str());
+}
+
+// one 60Hz host frame of 12MHz ticks, see above
+constexpr uint64_t DEFAULT_TOLERANCE = 12'000'000 / 60;
+
+} // anonymous namespace
+
+
+int main(int argc, char *argv[])
+{
+	uint64_t tolerance = DEFAULT_TOLERANCE;
+	bool rx_hashes = false;
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-')
+	{
+		if (arg + 1 < argc && !std::strcmp(argv[arg], "-t"))
+		{
+			tolerance = std::strtoull(argv[arg + 1], nullptr, 0);
+			arg += 2;
+		}
+		else if (!std::strcmp(argv[arg], "-x"))
+		{
+			rx_hashes = true;
+			arg++;
+		}
+		else
+		{
+			break;
+		}
+	}
+	if (argc - arg != 2)
+	{
+		std::fprintf(stderr, "Usage: c139diff [-t ticks] [-x] <a.log> <b.log>\n");
+		return 2;
+	}
+
+	trace a, b;
+	if (!load(argv[arg], a) || !load(argv[arg + 1], b))
+		return 2;
+
+	if (a.mode != b.mode)
+		std::printf("warning: comparing mode %s against mode %s\n", a.mode.c_str(), b.mode.c_str());
+
+	unsigned diffs = 0;
+	diffs += diff_irqs(a, b, tolerance);
+	diffs += diff_rams(a, b);
+	diffs += diff_rxs(a, b, rx_hashes);
+
+	if (a.mismatches || b.mismatches)
+	{
+		std::printf("scenario: %u vs %u failed expectations\n", a.mismatches, b.mismatches);
+		diffs += (a.mismatches != b.mismatches) ? 1 : 0;
+	}
+
+	report_cost(argv[arg], a);
+	report_cost(argv[arg + 1], b);
+
+	std::printf("%u difference(s)\n", diffs);
+	return diffs ? 1 : 0;
+}
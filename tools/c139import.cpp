@@ -0,0 +1,389 @@
+// license:BSD-3-Clause
+// copyright-holders:Ariane Fugmann
+/***************************************************************************
+
+    c139import - turn captured C139 logs into bench scenarios
+
+    Usage: c139import [-r regbase] [-m rambase] [-d dumpoffset] [-s name] <log>...
+
+    Understands the capture styles found in notes/:
+
+    Stopped at watchpoint 1 writing 00F6 to 0F30000A (PC=...)
+                                            MAME debugger watchpoints; the
+                                            register window defaults to the
+                                            first address seen & ~0xf (-r),
+                                            ram accesses need -m
+    0020   00 00 00 01 00 00 ...            hex dump of the tx buffer, big
+                                            endian words placed at ram word
+                                            offset -d (default 0)
+    writing REGISTER @ 0005 : 0004          logic analyser summaries
+    CYCLE: 0005 0004 ADDR:...               bus cycles; the second counter
+                                            counts 12MHz clocks and becomes
+                                            wait steps
+    memory @ 1000 | 01aa 0055 ...           ram / register snapshots; the
+    regs   @ 0000 | 000c 000d ...           first one of each kind in a
+                                            scenario is the initial state,
+                                            later ones are expected results
+    INTERRUPT!                              interrupt seen
+    -- name / - name -                      first one after a gap starts a
+                                            scenario, the rest are sections
+
+    The scenario written to stdout is what the c139bench driver plays:
+
+    scenario <name>
+    section <name>
+    w <reg> <data>                          register write
+    r <reg> <data>                          register read, expected value
+    m <offset> <data>...                    ram write
+    wait <ticks>                            12MHz ticks
+    irq                                     expect an interrupt since the
+                                            last check
+    expect m <offset> <data>...             expected ram contents
+    expect w <reg> <data>                   expected register contents
+    frame                                   end of a host frame
+
+***************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+struct options
+{
+	long regbase = -1;
+	long rambase = -1;
+	unsigned dumpoffset = 0;
+	std::string only;
+};
+
+class importer
+{
+public:
+	importer(const options &opts) : m_opts(opts) { }
+
+	bool import(const char *path);
+	void finish();
+
+private:
+	void emit(const std::string &line);
+	void op(const std::string &line);
+	void start_scenario(const std::string &name);
+	void start_section(const std::string &name);
+	void access(bool write, unsigned long address, unsigned data);
+	void snapshot(bool memory, unsigned offset, const std::vector<unsigned> &words);
+	void flush_dump();
+
+	const options &m_opts;
+	long m_regbase = -1;
+	std::string m_scenario;
+	bool m_selected = true;
+	bool m_gap = true;
+	bool m_seen_memory = false;
+	bool m_seen_regs = false;
+	bool m_pending_irq = false;
+	long m_last_clock = -1;
+	long m_wait = 0;
+	bool m_dirty = false;
+	std::string m_default_name;
+	std::vector<unsigned> m_dump;
+};
+
+void importer::emit(const std::string &line)
+{
+	if (m_selected)
+		std::printf("%s\n", line.c_str());
+}
+
+void importer::op(const std::string &line)
+{
+	// accesses before any heading belong to a scenario named after the file
+	if (m_scenario.empty())
+		start_scenario(m_default_name);
+
+	if (m_wait > 0)
+	{
+		emit("wait " + std::to_string(m_wait));
+		m_wait = 0;
+	}
+	if (m_pending_irq)
+	{
+		m_pending_irq = false;
+		emit("irq");
+	}
+	emit(line);
+	m_dirty = true;
+}
+
+void importer::finish()
+{
+	flush_dump();
+	if (m_pending_irq)
+		op("frame");
+	else if (m_dirty)
+		emit("frame");
+	m_dirty = false;
+}
+
+void importer::start_scenario(const std::string &name)
+{
+	finish();
+
+	m_scenario = name;
+	m_selected = m_opts.only.empty() || m_opts.only == name;
+	m_regbase = m_opts.regbase;
+	m_seen_memory = false;
+	m_seen_regs = false;
+	m_pending_irq = false;
+	m_last_clock = -1;
+	m_wait = 0;
+	emit("");
+	emit("scenario " + name);
+}
+
+void importer::start_section(const std::string &name)
+{
+	if (m_scenario.empty())
+		start_scenario(m_default_name);
+	finish();
+	emit("section " + name);
+}
+
+void importer::access(bool write, unsigned long address, unsigned data)
+{
+	if (m_regbase < 0)
+		m_regbase = address & ~0xfUL;
+
+	char line[64];
+	if (address >= (unsigned long)m_regbase && address < (unsigned long)m_regbase + 0x10)
+	{
+		std::snprintf(line, sizeof(line), "%c %u %04x", write ? 'w' : 'r', unsigned((address & 0xf) >> 1), data & 0xffff);
+	}
+	else if (m_opts.rambase >= 0 && address >= (unsigned long)m_opts.rambase && address < (unsigned long)m_opts.rambase + 0x4000)
+	{
+		unsigned const offset = (address - m_opts.rambase) >> 1;
+		if (write)
+			std::snprintf(line, sizeof(line), "m %04x %04x", offset, data & 0x1ff);
+		else
+			std::snprintf(line, sizeof(line), "expect m %04x %04x", offset, data & 0x1ff);
+	}
+	else
+	{
+		std::fprintf(stderr, "c139import: skipping access to %08lx outside the c139 windows\n", address);
+		return;
+	}
+	flush_dump();
+	op(line);
+}
+
+void importer::snapshot(bool memory, unsigned offset, const std::vector<unsigned> &words)
+{
+	flush_dump();
+	bool &seen = memory ? m_seen_memory : m_seen_regs;
+	bool const initial = !seen;
+	seen = true;
+
+	std::ostringstream line;
+	char word[8];
+	if (memory)
+	{
+		line << (initial ? "m" : "expect m");
+		std::snprintf(word, sizeof(word), " %04x", offset);
+		line << word;
+		for (unsigned data : words)
+		{
+			std::snprintf(word, sizeof(word), " %04x", data);
+			line << word;
+		}
+		op(line.str());
+	}
+	else
+	{
+		// status is not writable, everything else is restored register by register
+		for (unsigned i = 0; i < words.size() && (offset + i) < 8; i++)
+		{
+			if (initial && (offset + i) == 0)
+				continue;
+			char reg[32];
+			std::snprintf(reg, sizeof(reg), "%s %u %04x", initial ? "w" : "expect w", offset + i, words[i]);
+			op(reg);
+		}
+	}
+}
+
+void importer::flush_dump()
+{
+	if (m_dump.empty())
+		return;
+
+	// tx buffers are big endian words, sixteen to a line
+	unsigned const words = m_dump.size() / 2;
+	for (unsigned base = 0; base < words; base += 16)
+	{
+		char line[128];
+		int pos = std::snprintf(line, sizeof(line), "m %04x", m_opts.dumpoffset + base);
+		for (unsigned i = base; i < words && i < base + 16; i++)
+			pos += std::snprintf(&line[pos], sizeof(line) - pos, " %04x", ((m_dump[i * 2] << 8) | m_dump[i * 2 + 1]) & 0x1ff);
+		op(line);
+	}
+	m_dump.clear();
+}
+
+bool importer::import(const char *path)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::fprintf(stderr, "c139import: cannot open %s\n", path);
+		return false;
+	}
+
+	m_default_name = path;
+	size_t const slash = m_default_name.find_last_of("/\\");
+	if (slash != std::string::npos)
+		m_default_name.erase(0, slash + 1);
+	m_default_name = m_default_name.substr(0, m_default_name.find('.'));
+
+	std::regex const watchpoint(R"(Stopped at watchpoint \d+ (writing|reading) ([0-9A-Fa-f]+) (?:to|from) ([0-9A-Fa-f]+))");
+	std::regex const hexdump(R"(^([0-9A-Fa-f]{4})\s+((?:[0-9A-Fa-f]{2}\s*){1,16})$)");
+	std::regex const analyser(R"(writing (REGISTER|MEMORY) @ ([0-9A-Fa-f]+) : ([0-9A-Fa-f]+))");
+	std::regex const cycle(R"(^CYCLE: [0-9A-Fa-f]+ ([0-9A-Fa-f]+) )");
+	std::regex const snap(R"((memory|regs)\s+@ ([0-9A-Fa-f]+) \|((?:\s+[0-9A-Fa-f]{4})+))");
+	std::regex const heading(R"(^-{1,2}\s*(.*?)\s*-*\s*$)");
+
+	std::string line;
+	std::smatch match;
+	while (std::getline(file, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line.find_first_not_of(" \t") == std::string::npos)
+		{
+			m_gap = true;
+			continue;
+		}
+
+		if (std::regex_search(line, match, cycle))
+		{
+			// only used for timing, the summaries carry the accesses
+			long const clock = std::strtol(match[1].str().c_str(), nullptr, 16);
+			if (m_last_clock >= 0 && clock > m_last_clock)
+				m_wait += clock - m_last_clock;
+			m_last_clock = clock;
+			m_gap = false;
+			continue;
+		}
+
+		if (line.rfind("INTERRUPT!", 0) == 0)
+		{
+			flush_dump();
+			m_pending_irq = true;
+			continue;
+		}
+
+		if (std::regex_search(line, match, watchpoint))
+		{
+			access(match[1] == "writing", std::strtoul(match[3].str().c_str(), nullptr, 16), std::strtoul(match[2].str().c_str(), nullptr, 16));
+		}
+		else if (std::regex_search(line, match, analyser))
+		{
+			unsigned const offset = std::strtoul(match[2].str().c_str(), nullptr, 16);
+			unsigned const data = std::strtoul(match[3].str().c_str(), nullptr, 16);
+			char out[64];
+			if (match[1] == "REGISTER")
+				std::snprintf(out, sizeof(out), "w %u %04x", offset & 7, data);
+			else
+				std::snprintf(out, sizeof(out), "m %04x %04x", offset & 0x1fff, data & 0x1ff);
+			flush_dump();
+			op(out);
+		}
+		else if (std::regex_search(line, match, snap))
+		{
+			std::vector<unsigned> words;
+			std::istringstream fields(match[3].str());
+			std::string word;
+			while (fields >> word)
+				words.push_back(std::strtoul(word.c_str(), nullptr, 16));
+			snapshot(match[1] == "memory", std::strtoul(match[2].str().c_str(), nullptr, 16), words);
+		}
+		else if (std::regex_match(line, match, hexdump))
+		{
+			// dumps restart at 0000, a new one replaces whatever was pending
+			unsigned const address = std::strtoul(match[1].str().c_str(), nullptr, 16);
+			if (address == 0)
+				flush_dump();
+			m_dump.resize(address);
+			std::istringstream fields(match[2].str());
+			std::string byte;
+			while (fields >> byte)
+				m_dump.push_back(std::strtoul(byte.c_str(), nullptr, 16));
+		}
+		else if (std::regex_match(line, match, heading) && line.rfind("##", 0) != 0)
+		{
+			std::string const name = match[1].str();
+			if (name.empty())
+			{
+				// bare "--" closes a dump or separates captures
+				flush_dump();
+				m_last_clock = -1;
+			}
+			else if (m_gap || m_scenario.empty())
+			{
+				start_scenario(name);
+			}
+			else
+			{
+				start_section(name);
+			}
+		}
+		m_gap = false;
+	}
+	return true;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char *argv[])
+{
+	options opts;
+	int arg = 1;
+	while (arg + 1 < argc && argv[arg][0] == '-' && argv[arg][1] && !argv[arg][2])
+	{
+		char const *const value = argv[arg + 1];
+		switch (argv[arg][1])
+		{
+			case 'r': opts.regbase = std::strtol(value, nullptr, 16); break;
+			case 'm': opts.rambase = std::strtol(value, nullptr, 16); break;
+			case 'd': opts.dumpoffset = std::strtoul(value, nullptr, 16); break;
+			case 's': opts.only = value; break;
+			default:
+				std::fprintf(stderr, "c139import: unknown option %s\n", argv[arg]);
+				return 2;
+		}
+		arg += 2;
+	}
+	if (arg >= argc)
+	{
+		std::fprintf(stderr, "Usage: c139import [-r regbase] [-m rambase] [-d dumpoffset] [-s name] <log>...\n");
+		return 2;
+	}
+
+	std::printf("# c139 scenario\n");
+	for (; arg < argc; arg++)
+	{
+		importer imp(opts);
+		if (!imp.import(argv[arg]))
+			return 1;
+		imp.finish();
+	}
+	return 0;
+}
@@ -0,0 +1,626 @@
+// license:BSD-3-Clause
+// copyright-holders:Ariane Fugmann
+/***************************************************************************
+
+    c139ring - decode C139 ring line captures
+
+    Usage: c139ring [-b mbps] [-r rate] [-t chan] [-i chan] [-g bits]
+                    [-l linkid] [-o capfile] [-v] <capture>
+           c139ring -s [-b mbps] [-r rate] [-t chan] <out.raw> <word>...
+
+    -b      bit rate, 1 or 2 Mbps (default 1)
+    -r      sample rate of raw dumps in Hz (default 24000000)
+    -t      RINGOUT channel (default 0, or RINGOUT for VCD)
+    -i      RINGIN channel (default 1, or RINGIN for VCD)
+    -g      idle bit times that end a frame (default 22)
+    -l      link id stored with every frame (default 0)
+    -o      write the frames in the emulator's capture format, RINGOUT as
+            tx and RINGIN as rx, for <link replay="..."/>
+    -v      list every word
+
+    Captures ending in .vcd are read as value change dumps and channels
+    name the signals; anything else is a raw dump of one byte per sample
+    and channels are bit numbers within it, as written by sigrok's binary
+    output or most logic analyser exports.
+
+    -s synthesises a raw dump instead, for checking the decoder: every
+    argument is a word in hex, "!word" sends it with a low stop bit and
+    "+n" idles the line for n bit times. c139ring_test.sh runs a word
+    list through -s and back through the decoder at both bit rates.
+
+    The summary lists words, sync words, framing errors and the idle gaps
+    between words per line. Exit status is 0 on success and 2 on errors.
+
+***************************************************************************/
+
+#include "c139ring.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+using namespace c139ring;
+
+const char CAPTURE_MAGIC[8] = { 'C', '1', '3', '9', 'C', 'A', 'P', 1 };
+
+constexpr size_t CHUNK_SIZE = 1 << 20;
+
+struct options
+{
+	unsigned mbps = 1;
+	double rate = 24'000'000.0;
+	std::string tx;
+	std::string rx;
+	double gap_bits = 22.0;
+	unsigned linkid = 0;
+	const char *output = nullptr;
+	bool verbose = false;
+	bool synth = false;
+};
+
+
+//-------------------------------------------------
+//  one decoded line
+//-------------------------------------------------
+
+class line_decoder
+{
+public:
+	line_decoder(const char *name, bool tx, double bit_period, const options &opts) :
+		m_name(name),
+		m_tx(tx),
+		m_verbose(opts.verbose),
+		m_decoder(bit_period, [this] (const ring_word &word) { decoded(word); }),
+		m_framer(opts.gap_bits, [this] (ring_frame &&frame) { m_frames.push_back(std::move(frame)); })
+	{ }
+
+	void set_time_scale(double seconds_per_unit) { m_seconds = seconds_per_unit; }
+	void set_bit_period(double bit_period) { m_decoder.set_bit_period(bit_period); }
+	ring_decoder &decoder() { return m_decoder; }
+
+	void level(double time, bool level) { m_decoder.level(time, level); }
+	void finish(double time) { m_decoder.finish(time); m_framer.flush(); }
+	double horizon(double now) const { return m_framer.horizon(m_decoder.horizon(now)); }
+
+	bool tx() const { return m_tx; }
+	std::deque<ring_frame> &frames() { return m_frames; }
+	double seconds(double time) const { return time * m_seconds; }
+
+	void summary() const
+	{
+		std::printf("%-8s %" PRIu64 " words, %" PRIu64 " frames, %" PRIu64 " sync, %" PRIu64 " framing errors, %" PRIu64 " false starts\n",
+				m_name, m_decoder.words(), m_framer.frames(), m_sync, m_decoder.framing_errors(), m_decoder.false_starts());
+		if (m_gaps)
+			std::printf("%-8s gap between words: min %.1f, avg %.1f, max %.1f bit times\n",
+					m_name, m_gap_min, m_gap_total / double(m_gaps), m_gap_max);
+	}
+
+private:
+	void decoded(const ring_word &word)
+	{
+		if (word.data & 0x100)
+			m_sync++;
+
+		// the first word has nothing to measure against
+		if (m_decoder.words() > 1)
+		{
+			m_gaps++;
+			m_gap_total += word.gap;
+			m_gap_min = std::min(m_gap_min, word.gap);
+			m_gap_max = std::max(m_gap_max, word.gap);
+		}
+
+		if (m_verbose)
+			std::printf("%14.3f us  %-8s %03x%s%s  gap %.1f\n",
+					seconds(word.start) * 1e6, m_name, word.data,
+					(word.data & 0x100) ? " sync" : "",
+					word.framing_error ? " framing error" : "",
+					word.gap);
+
+		m_framer.word(word);
+	}
+
+	const char *const m_name;
+	bool const m_tx;
+	bool const m_verbose;
+	double m_seconds = 1.0;
+	ring_decoder m_decoder;
+	ring_framer m_framer;
+	std::deque<ring_frame> m_frames;
+
+	uint64_t m_sync = 0;
+	uint64_t m_gaps = 0;
+	double m_gap_total = 0.0;
+	double m_gap_min = std::numeric_limits<double>::max();
+	double m_gap_max = 0.0;
+};
+
+
+//-------------------------------------------------
+//  capture file output
+//-------------------------------------------------
+
+class capture_writer
+{
+public:
+	bool open(const char *path)
+	{
+		m_file.open(path, std::ios::binary | std::ios::trunc);
+		if (!m_file)
+		{
+			std::fprintf(stderr, "c139ring: cannot create %s\n", path);
+			return false;
+		}
+		m_file.write(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+		return true;
+	}
+
+	// write out every frame that starts before horizon, oldest first
+	void drain(line_decoder *const *lines, size_t count, double horizon, unsigned linkid)
+	{
+		while (true)
+		{
+			line_decoder *first = nullptr;
+			for (size_t i = 0; i < count; i++)
+			{
+				if (!lines[i]->frames().empty() && (!first || lines[i]->frames().front().start < first->frames().front().start))
+					first = lines[i];
+			}
+			if (!first || first->frames().front().start >= horizon)
+				return;
+
+			if (m_file.is_open())
+				write(*first, first->frames().front(), linkid);
+			first->frames().pop_front();
+		}
+	}
+
+private:
+	void write(const line_decoder &line, const ring_frame &frame, unsigned linkid)
+	{
+		// same layout as namco_c139_device::capture_frame
+		uint64_t const ticks = uint64_t(std::llround(line.seconds(frame.start) * 12'000'000.0));
+		uint8_t header[11];
+		for (unsigned i = 0; i < 8; i++)
+			header[i] = uint8_t(ticks >> (i * 8));
+		header[8] = line.tx() ? 1 : 0;
+		header[9] = uint8_t(linkid);
+		header[10] = uint8_t(frame.words.size());
+		m_file.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+		for (uint16_t const word : frame.words)
+		{
+			uint8_t const bytes[2] = { uint8_t(word), uint8_t(word >> 8) };
+			m_file.write(reinterpret_cast<const char *>(bytes), sizeof(bytes));
+		}
+	}
+
+	std::ofstream m_file;
+};
+
+
+//-------------------------------------------------
+//  raw sample dumps
+//-------------------------------------------------
+
+bool parse_channel(const std::string &text, unsigned &channel)
+{
+	char *end;
+	unsigned long const value = std::strtoul(text.c_str(), &end, 10);
+	if (text.empty() || *end || value > 7)
+	{
+		std::fprintf(stderr, "c139ring: raw dump channels are bits 0-7, not '%s'\n", text.c_str());
+		return false;
+	}
+	channel = unsigned(value);
+	return true;
+}
+
+bool decode_raw(const char *path, const options &opts, line_decoder &tx, line_decoder &rx, capture_writer &writer)
+{
+	unsigned tx_channel, rx_channel;
+	if (!parse_channel(opts.tx.empty() ? "0" : opts.tx, tx_channel) || !parse_channel(opts.rx.empty() ? "1" : opts.rx, rx_channel))
+		return false;
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::fprintf(stderr, "c139ring: cannot open %s\n", path);
+		return false;
+	}
+
+	tx.set_time_scale(1.0 / opts.rate);
+	rx.set_time_scale(1.0 / opts.rate);
+
+	sample_scanner scanner;
+	scanner.add_channel(tx_channel, tx.decoder());
+	scanner.add_channel(rx_channel, rx.decoder());
+
+	line_decoder *const lines[2] = { &tx, &rx };
+	std::vector<uint8_t> buffer(CHUNK_SIZE);
+	while (file)
+	{
+		file.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+		scanner.scan(buffer.data(), size_t(file.gcount()));
+
+		double const now = double(scanner.position());
+		writer.drain(lines, 2, std::min(tx.horizon(now), rx.horizon(now)), opts.linkid);
+	}
+
+	scanner.finish();
+	double const end = double(scanner.position());
+	tx.finish(end);
+	rx.finish(end);
+	writer.drain(lines, 2, std::numeric_limits<double>::max(), opts.linkid);
+
+	std::printf("%" PRIu64 " samples, %.6f seconds\n", scanner.position(), end / opts.rate);
+	return true;
+}
+
+
+//-------------------------------------------------
+//  value change dumps
+//-------------------------------------------------
+
+bool same_name(const char *a, const char *b)
+{
+	for ( ; *a && *b; a++, b++)
+	{
+		if (std::toupper(uint8_t(*a)) != std::toupper(uint8_t(*b)))
+			return false;
+	}
+	return !*a && !*b;
+}
+
+class vcd_reader
+{
+public:
+	vcd_reader(const options &opts, line_decoder &tx, line_decoder &rx, capture_writer &writer) :
+		m_opts(opts),
+		m_tx(tx),
+		m_rx(rx),
+		m_writer(writer),
+		m_tx_name(opts.tx.empty() ? "RINGOUT" : opts.tx),
+		m_rx_name(opts.rx.empty() ? "RINGIN" : opts.rx)
+	{ }
+
+	bool read(const char *path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			std::fprintf(stderr, "c139ring: cannot open %s\n", path);
+			return false;
+		}
+
+		// tokens can straddle chunks, so carry the tail over
+		std::vector<char> buffer(CHUNK_SIZE);
+		std::string token;
+		while (file)
+		{
+			file.read(buffer.data(), buffer.size());
+			size_t const count = size_t(file.gcount());
+			for (size_t i = 0; i < count; i++)
+			{
+				char const c = buffer[i];
+				if (!std::isspace(uint8_t(c)))
+				{
+					token.push_back(c);
+				}
+				else if (!token.empty())
+				{
+					if (!process(token))
+						return false;
+					token.clear();
+				}
+			}
+
+			line_decoder *const lines[2] = { &m_tx, &m_rx };
+			double const now = double(m_time);
+			m_writer.drain(lines, 2, std::min(m_tx.horizon(now), m_rx.horizon(now)), m_opts.linkid);
+		}
+		if (!token.empty() && !process(token))
+			return false;
+
+		if (m_tx_id.empty() && m_rx_id.empty())
+		{
+			std::fprintf(stderr, "c139ring: %s has neither %s nor %s\n", path, m_tx_name.c_str(), m_rx_name.c_str());
+			return false;
+		}
+
+		line_decoder *const lines[2] = { &m_tx, &m_rx };
+		m_tx.finish(double(m_time));
+		m_rx.finish(double(m_time));
+		m_writer.drain(lines, 2, std::numeric_limits<double>::max(), m_opts.linkid);
+
+		std::printf("%" PRIu64 " time units, %.6f seconds\n", m_time, double(m_time) * m_timescale);
+		return true;
+	}
+
+private:
+	enum class section { NONE, TIMESCALE, VAR, SKIP };
+
+	bool process(const std::string &token)
+	{
+		if (m_section == section::TIMESCALE)
+			return timescale(token);
+		if (m_section == section::VAR)
+			return var(token);
+		if (m_section == section::SKIP)
+		{
+			if (token == "$end")
+				m_section = section::NONE;
+			return true;
+		}
+
+		if (token == "$timescale")
+		{
+			m_section = section::TIMESCALE;
+			m_timescale_text.clear();
+		}
+		else if (token == "$var")
+		{
+			m_section = section::VAR;
+			m_var.clear();
+		}
+		else if (token == "$dumpvars" || token == "$dumpon" || token == "$dumpoff" || token == "$dumpall" || token == "$end")
+		{
+			// value changes follow as usual
+		}
+		else if (token[0] == '$')
+		{
+			m_section = section::SKIP;
+		}
+		else if (token[0] == '#')
+		{
+			m_time = std::strtoull(token.c_str() + 1, nullptr, 10);
+		}
+		else if (m_vector_pending)
+		{
+			m_vector_pending = false;
+			change(token, m_vector_value);
+		}
+		else if (token[0] == 'b' || token[0] == 'B')
+		{
+			// one bit vectors, the value comes before the id
+			m_vector_pending = true;
+			m_vector_value = token.back();
+		}
+		else if (token[0] == 'r' || token[0] == 'R')
+		{
+			m_real_pending = true;
+		}
+		else if (m_real_pending)
+		{
+			m_real_pending = false;
+		}
+		else
+		{
+			change(token.substr(1), token[0]);
+		}
+		return true;
+	}
+
+	bool timescale(const std::string &token)
+	{
+		if (token != "$end")
+		{
+			m_timescale_text += token;
+			return true;
+		}
+		m_section = section::NONE;
+
+		char *unit;
+		double const value = std::strtod(m_timescale_text.c_str(), &unit);
+		static const struct { const char *name; double scale; } UNITS[] = {
+				{ "s", 1.0 }, { "ms", 1e-3 }, { "us", 1e-6 }, { "ns", 1e-9 }, { "ps", 1e-12 }, { "fs", 1e-15 } };
+		for (auto const &u : UNITS)
+		{
+			if (!std::strcmp(unit, u.name))
+			{
+				m_timescale = value * u.scale;
+				double const period = 1e-6 / (m_opts.mbps * m_timescale);
+				if (period < 2.0)
+				{
+					std::fprintf(stderr, "c139ring: timescale %s is too coarse for %u Mbps\n", m_timescale_text.c_str(), m_opts.mbps);
+					return false;
+				}
+				m_tx.set_time_scale(m_timescale);
+				m_rx.set_time_scale(m_timescale);
+				m_tx.set_bit_period(period);
+				m_rx.set_bit_period(period);
+				return true;
+			}
+		}
+		std::fprintf(stderr, "c139ring: bad timescale '%s'\n", m_timescale_text.c_str());
+		return false;
+	}
+
+	bool var(const std::string &token)
+	{
+		if (token != "$end")
+		{
+			m_var.push_back(token);
+			return true;
+		}
+		m_section = section::NONE;
+
+		// type size id reference [index]
+		if (m_var.size() < 4 || m_var[1] != "1")
+			return true;
+		if (same_name(m_var[3].c_str(), m_tx_name.c_str()))
+			m_tx_id = m_var[2];
+		else if (same_name(m_var[3].c_str(), m_rx_name.c_str()))
+			m_rx_id = m_var[2];
+		return true;
+	}
+
+	void change(const std::string &id, char value)
+	{
+		// x and z read as idle
+		bool const level = (value != '0');
+		if (id == m_tx_id)
+			m_tx.level(double(m_time), level);
+		else if (id == m_rx_id)
+			m_rx.level(double(m_time), level);
+	}
+
+	const options &m_opts;
+	line_decoder &m_tx;
+	line_decoder &m_rx;
+	capture_writer &m_writer;
+	std::string const m_tx_name;
+	std::string const m_rx_name;
+
+	section m_section = section::NONE;
+	std::string m_timescale_text;
+	std::vector<std::string> m_var;
+	std::string m_tx_id;
+	std::string m_rx_id;
+	double m_timescale = 1e-9;
+	uint64_t m_time = 0;
+	bool m_vector_pending = false;
+	char m_vector_value = '1';
+	bool m_real_pending = false;
+};
+
+
+//-------------------------------------------------
+//  synthetic waveforms
+//-------------------------------------------------
+
+bool synthesise(const char *path, const options &opts, char *const *words, int count)
+{
+	unsigned channel;
+	if (!parse_channel(opts.tx.empty() ? "0" : opts.tx, channel))
+		return false;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::fprintf(stderr, "c139ring: cannot create %s\n", path);
+		return false;
+	}
+
+	// bit edges land on the nearest sample, like a real analyser sees them
+	double const period = opts.rate / (opts.mbps * 1e6);
+	double time = 0.0;
+	uint64_t written = 0;
+	uint8_t const high = uint8_t(1 << channel);
+	auto const emit = [&] (bool level, double bits)
+	{
+		time += bits * period;
+		uint64_t const until = uint64_t(std::llround(time));
+		for ( ; written < until; written++)
+			file.put(char(level ? high : 0));
+	};
+
+	emit(true, 16.0);
+	for (int i = 0; i < count; i++)
+	{
+		char const *arg = words[i];
+		if (arg[0] == '+')
+		{
+			emit(true, std::strtod(arg + 1, nullptr));
+			continue;
+		}
+
+		bool const error = (arg[0] == '!');
+		unsigned const data = std::strtoul(arg + (error ? 1 : 0), nullptr, 16) & 0x1ff;
+		emit(false, 1.0);
+		for (int bit = 8; bit >= 0; bit--)
+			emit((data >> bit) & 1, 1.0);
+		emit(!error, 1.0);
+
+		// give a broken stop bit a rising edge to resync on
+		if (error)
+			emit(true, 1.0);
+	}
+	emit(true, 16.0);
+
+	std::printf("%" PRIu64 " samples\n", written);
+	return true;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char *argv[])
+{
+	options opts;
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-' && argv[arg][1] && !argv[arg][2])
+	{
+		char const option = argv[arg][1];
+		if (option == 'v' || option == 's')
+		{
+			(option == 'v' ? opts.verbose : opts.synth) = true;
+			arg++;
+			continue;
+		}
+		if (arg + 1 >= argc)
+			break;
+
+		char const *const value = argv[arg + 1];
+		switch (option)
+		{
+			case 'b': opts.mbps = std::strtoul(value, nullptr, 10); break;
+			case 'r': opts.rate = std::strtod(value, nullptr); break;
+			case 't': opts.tx = value; break;
+			case 'i': opts.rx = value; break;
+			case 'g': opts.gap_bits = std::strtod(value, nullptr); break;
+			case 'l': opts.linkid = std::strtoul(value, nullptr, 16); break;
+			case 'o': opts.output = value; break;
+			default:
+				std::fprintf(stderr, "c139ring: unknown option %s\n", argv[arg]);
+				return 2;
+		}
+		arg += 2;
+	}
+	if (arg >= argc || (opts.mbps != 1 && opts.mbps != 2) || opts.rate <= 0.0)
+	{
+		std::fprintf(stderr, "Usage: c139ring [-b mbps] [-r rate] [-t chan] [-i chan] [-g bits] [-l linkid] [-o capfile] [-v] <capture>\n");
+		std::fprintf(stderr, "       c139ring -s [-b mbps] [-r rate] [-t chan] <out.raw> <word>...\n");
+		return 2;
+	}
+
+	if (opts.synth)
+		return synthesise(argv[arg], opts, &argv[arg + 1], argc - arg - 1) ? 0 : 2;
+
+	if (opts.rate / (opts.mbps * 1e6) < 2.0)
+	{
+		std::fprintf(stderr, "c139ring: need at least two samples per bit\n");
+		return 2;
+	}
+
+	// bit periods are in samples for raw dumps, VCD replaces them from its timescale
+	double const period = opts.rate / (opts.mbps * 1e6);
+	line_decoder tx("RINGOUT", true, period, opts);
+	line_decoder rx("RINGIN", false, period, opts);
+	capture_writer writer;
+	if (opts.output && !writer.open(opts.output))
+		return 2;
+
+	char const *const path = argv[arg];
+	size_t const length = std::strlen(path);
+	bool const vcd = (length > 4) && same_name(path + length - 4, ".vcd");
+	bool const ok = vcd ? vcd_reader(opts, tx, rx, writer).read(path) : decode_raw(path, opts, tx, rx, writer);
+	if (!ok)
+		return 2;
+
+	tx.summary();
+	rx.summary();
+	return 0;
+}
@@ -0,0 +1,390 @@
+// license:BSD-3-Clause
+// copyright-holders:Ariane Fugmann
+/***************************************************************************
+
+    c139ring.h - streaming decoder for C139 ring line captures
+
+    The C139 sends 9-N-1 at 1 or 2Mbps (reg3 bit 1): a low start bit, nine
+    data bits msb first and a high stop bit, the line idling high between
+    words. Bit 8 is the sync bit.
+
+    ring_decoder turns level changes on one line into words, flagging
+    framing errors and measuring the idle gap in front of every word.
+    ring_framer groups words into frames the way the emulator stores them
+    in its capture files: a frame ends after a sync word, after a gap or
+    when it reaches 0xff words. sample_scanner feeds a decoder from raw
+    logic analyser samples, one byte per sample, 64 samples at a time, so
+    idle stretches cost one compare per 64 samples.
+
+    Times are doubles in any unit, as long as the bit period uses the same
+    one (samples for raw dumps, the timescale for VCD).
+
+***************************************************************************/
+#ifndef C139_TOOLS_C139RING_H
+#define C139_TOOLS_C139RING_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <utility>
+#include <vector>
+
+
+namespace c139ring {
+
+struct ring_word
+{
+	double start;           // falling edge of the start bit
+	uint16_t data;          // 9 bits, bit 8 is the sync bit
+	bool framing_error;     // stop bit was low
+	double gap;             // idle bit times since the previous stop bit
+};
+
+struct ring_frame
+{
+	double start;           // start of the first word
+	std::vector<uint16_t> words;
+};
+
+
+//**************************************************************************
+//  WORD DECODER
+//**************************************************************************
+
+class ring_decoder
+{
+public:
+	using word_delegate = std::function<void (const ring_word &)>;
+
+	ring_decoder(double bit_period, word_delegate &&word) :
+		m_period(bit_period),
+		m_word(std::move(word))
+	{ }
+
+	// only before the first edge
+	void set_bit_period(double bit_period) { m_period = bit_period; }
+
+	// the line is at level from time on, times must not go backwards
+	void level(double time, bool level)
+	{
+		if (!m_started)
+		{
+			// the first level is where the capture begins, not an edge; a
+			// line that starts low has to come up before a start bit counts
+			m_started = true;
+			m_level = level;
+			m_state = level ? state::IDLE : state::WAIT_IDLE;
+			m_last_end = time;
+			return;
+		}
+
+		advance(time);
+		if (level == m_level)
+			return;
+		m_level = level;
+
+		if (!level && m_state == state::IDLE)
+		{
+			// falling edge, sample every bit in its middle from here
+			m_state = state::ACTIVE;
+			m_start = time;
+			m_sample = time + (m_period * 0.5);
+			m_bit = 0;
+			m_data = 0;
+		}
+		else if (level && m_state == state::WAIT_IDLE)
+		{
+			m_state = state::IDLE;
+		}
+	}
+
+	// end of capture, a word still in flight is dropped
+	void finish(double time)
+	{
+		advance(time);
+		m_state = state::IDLE;
+	}
+
+	// nothing before this can still turn into a word
+	double horizon(double now) const { return (m_state == state::ACTIVE) ? m_start : now; }
+
+	uint64_t words() const { return m_words; }
+	uint64_t framing_errors() const { return m_errors; }
+	uint64_t false_starts() const { return m_false_starts; }
+
+private:
+	enum class state { IDLE, ACTIVE, WAIT_IDLE };
+
+	void advance(double until)
+	{
+		while (m_state == state::ACTIVE && m_sample < until)
+		{
+			if (m_bit == 0)
+			{
+				// a glitch shorter than half a bit is not a start bit
+				if (m_level)
+				{
+					m_false_starts++;
+					m_state = state::IDLE;
+					return;
+				}
+			}
+			else if (m_bit <= 9)
+			{
+				m_data = (m_data << 1) | (m_level ? 1 : 0);
+			}
+			else
+			{
+				ring_word word;
+				word.start = m_start;
+				word.data = m_data;
+				word.framing_error = !m_level;
+				word.gap = (m_start - m_last_end) / m_period;
+				m_last_end = m_start + (m_period * 11.0);
+				m_words++;
+				if (word.framing_error)
+					m_errors++;
+
+				// after a framing error wait for the line to come back up
+				m_state = word.framing_error ? state::WAIT_IDLE : state::IDLE;
+				m_word(word);
+				return;
+			}
+			m_bit++;
+			m_sample += m_period;
+		}
+	}
+
+	double m_period;
+	word_delegate const m_word;
+
+	state m_state = state::IDLE;
+	bool m_started = false;
+	bool m_level = true;
+	double m_start = 0.0;
+	double m_sample = 0.0;
+	double m_last_end = 0.0;
+	unsigned m_bit = 0;
+	uint16_t m_data = 0;
+
+	uint64_t m_words = 0;
+	uint64_t m_errors = 0;
+	uint64_t m_false_starts = 0;
+};
+
+
+//**************************************************************************
+//  FRAMER
+//**************************************************************************
+
+class ring_framer
+{
+public:
+	using frame_delegate = std::function<void (ring_frame &&)>;
+
+	static constexpr size_t MAX_WORDS = 0xff;
+
+	ring_framer(double gap_bits, frame_delegate &&frame) :
+		m_gap_bits(gap_bits),
+		m_frame(std::move(frame))
+	{ }
+
+	void word(const ring_word &word)
+	{
+		if (!m_current.words.empty() && word.gap >= m_gap_bits)
+			flush();
+
+		if (m_current.words.empty())
+			m_current.start = word.start;
+		m_current.words.push_back(word.data);
+
+		if ((word.data & 0x100) || m_current.words.size() == MAX_WORDS)
+			flush();
+	}
+
+	void flush()
+	{
+		if (m_current.words.empty())
+			return;
+		m_frames++;
+		m_frame(std::move(m_current));
+		m_current = ring_frame();
+	}
+
+	// nothing before this can still turn into a frame
+	double horizon(double decoder_horizon) const { return m_current.words.empty() ? decoder_horizon : m_current.start; }
+
+	uint64_t frames() const { return m_frames; }
+
+private:
+	double const m_gap_bits;
+	frame_delegate const m_frame;
+	ring_frame m_current;
+	uint64_t m_frames = 0;
+};
+
+
+//**************************************************************************
+//  RAW SAMPLE SCANNER
+//**************************************************************************
+
+class sample_scanner
+{
+public:
+	// one decoder per channel, channel is the bit within each sample byte
+	void add_channel(unsigned channel, ring_decoder &decoder)
+	{
+		m_channels.push_back(lane{ channel, &decoder, 0, false });
+	}
+
+	// samples continue where the previous call left off
+	void scan(const uint8_t *samples, size_t count)
+	{
+		size_t pos = 0;
+
+		// finish a partial block from the previous call first
+		while (m_fill && pos < count)
+			push_sample(samples[pos++]);
+
+		for ( ; pos + 64 <= count; pos += 64)
+			full_block(&samples[pos]);
+
+		while (pos < count)
+			push_sample(samples[pos++]);
+	}
+
+	// flush a partial block at the end of the capture
+	void finish()
+	{
+		if (!m_fill)
+			return;
+		for (lane &l : m_channels)
+		{
+			uint64_t bits = gather(m_partial, l.channel);
+
+			// pad with the last level so the padding never creates an edge
+			if ((bits >> (m_fill - 1)) & 1)
+				bits |= ~uint64_t(0) << m_fill;
+			else
+				bits &= ~(~uint64_t(0) << m_fill);
+			block(l, bits);
+		}
+		m_position += m_fill;
+		m_fill = 0;
+	}
+
+	uint64_t position() const { return m_position; }
+
+private:
+	struct lane
+	{
+		unsigned channel;
+		ring_decoder *decoder;
+		uint64_t last;          // level of the previous sample, 0 or 1
+		bool started;
+	};
+
+	void push_sample(uint8_t sample)
+	{
+		m_partial[m_fill++] = sample;
+		if (m_fill == 64)
+		{
+			full_block(m_partial);
+			m_fill = 0;
+		}
+	}
+
+	void full_block(const uint8_t *samples)
+	{
+		// fold the block so a line that doesn't move costs nothing more
+		uint64_t any = 0, all = ~uint64_t(0);
+		for (unsigned i = 0; i < 64; i += 8)
+		{
+			uint64_t const eight = load_le64(&samples[i]);
+			any |= eight;
+			all &= eight;
+		}
+
+		for (lane &l : m_channels)
+		{
+			uint64_t const mask = uint64_t(0x0101010101010101U) << l.channel;
+			bool const steady = l.started && (l.last ? ((all & mask) == mask) : !(any & mask));
+			if (!steady)
+				block(l, gather(samples, l.channel));
+		}
+		m_position += 64;
+	}
+
+	// bit n of the result is the channel bit of sample n
+	static uint64_t gather(const uint8_t *samples, unsigned channel)
+	{
+		uint64_t result = 0;
+		for (unsigned i = 0; i < 64; i += 8)
+		{
+			uint64_t eight = load_le64(&samples[i]);
+
+			// one bit per byte into the top byte, then down to bit i
+			eight = (eight >> channel) & 0x0101010101010101U;
+			result |= ((eight * 0x0102040810204080U) >> 56) << i;
+		}
+		return result;
+	}
+
+	void block(lane &l, uint64_t bits)
+	{
+		if (!l.started)
+		{
+			l.started = true;
+			l.last = bits & 1;
+			l.decoder->level(double(m_position), l.last);
+		}
+
+		// bit n set where sample n differs from sample n - 1
+		uint64_t edges = bits ^ ((bits << 1) | l.last);
+		l.last = bits >> 63;
+		while (edges)
+		{
+			unsigned const n = count_trailing_zeros(edges);
+			edges &= edges - 1;
+			l.decoder->level(double(m_position + n), (bits >> n) & 1);
+		}
+	}
+
+	// sample n in byte n, whatever the host byte order
+	static uint64_t load_le64(const uint8_t *samples)
+	{
+		uint64_t result;
+		std::memcpy(&result, samples, sizeof(result));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+		result = __builtin_bswap64(result);
+#endif
+		return result;
+	}
+
+	static unsigned count_trailing_zeros(uint64_t value)
+	{
+#if defined(__GNUC__)
+		return __builtin_ctzll(value);
+#else
+		unsigned count = 0;
+		while (!(value & 1))
+		{
+			value >>= 1;
+			count++;
+		}
+		return count;
+#endif
+	}
+
+	std::vector<lane> m_channels;
+	uint8_t m_partial[64] = { };
+	unsigned m_fill = 0;
+	uint64_t m_position = 0;
+};
+
+} // namespace c139ring
+
+#endif // C139_TOOLS_C139RING_H
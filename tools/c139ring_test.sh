@@ -0,0 +1,47 @@
+#!/bin/sh
+# license:BSD-3-Clause
+# copyright-holders:Ariane Fugmann
+#
+# c139ring_test.sh - round trip check of the c139ring decoder
+#
+# Builds c139ring, synthesises raw dumps of a fixed word sequence at both
+# bit rates and a few sample rates, decodes them again and compares the
+# words, including the framing error and the word right after it.
+#
+# Usage: tools/c139ring_test.sh [work dir]
+#
+# CXX selects the compiler (default c++). Exit status is 0 when every
+# round trip matches.
+
+set -u
+
+TOOLS=$(cd "$(dirname "$0")" && pwd)
+WORK=${1:-$(mktemp -d)}
+CXX=${CXX:-c++}
+
+mkdir -p "$WORK" || exit 2
+"$CXX" -std=c++17 -O2 -I"$TOOLS" -o "$WORK/c139ring" "$TOOLS/c139ring.cpp" || exit 2
+
+# words as given to -s, and what the decoder has to list for them
+WORDS='1aa 055 +3 0a5 !05a 1ff +30 001 100'
+EXPECTED='1aa 055 0a5 05a! 1ff 001 100'
+
+failures=0
+for mbps in 1 2; do
+	for rate in 8000000 24000000 25000000 100000000; do
+		raw="$WORK/ring_${mbps}_${rate}.raw"
+		# shellcheck disable=SC2086
+		"$WORK/c139ring" -s -b "$mbps" -r "$rate" "$raw" $WORDS > /dev/null || exit 2
+
+		decoded=$("$WORK/c139ring" -v -b "$mbps" -r "$rate" "$raw" |
+				awk '$3 == "RINGOUT" { printf "%s%s%s", sep, $4, ($5 == "framing") ? "!" : ""; sep = " " }')
+		if [ "$decoded" != "$EXPECTED" ]; then
+			echo "FAIL ${mbps}Mbps at ${rate}Hz: got '$decoded', expected '$EXPECTED'"
+			failures=$((failures + 1))
+		else
+			echo "ok   ${mbps}Mbps at ${rate}Hz"
+		fi
+	done
+done
+
+[ "$failures" -eq 0 ]
@@ -0,0 +1,260 @@
+// license:BSD-3-Clause
+// copyright-holders:Ariane Fugmann
+/***************************************************************************
+
+    c139trace - pack and query C139.ino bus cycle traces
+
+    Usage: c139trace pack <log> <out.c139t>
+           c139trace info <trace.c139t>
+           c139trace dump [-r] <trace.c139t> [first [count]]
+           c139trace seek <trace.c139t> 12m|16m <count>
+           c139trace find [-n max] <trace.c139t> <cond>...
+
+    pack reads a serial log of the sketch with DEBUG_LOG on and stores its
+    CYCLE lines in the columnar format described in c139trace.h; other
+    lines are skipped. dump prints rows the way the sketch did, after a row
+    index column; with -r it prints the CYCLE lines alone, as they were
+    packed. seek finds the first row at a clock count and find lists rows
+    where all conditions hold, at most -n of them. A condition is high:LINE, low:LINE,
+    rise:LINE or fall:LINE on the pin level, so
+
+        c139trace find trace.c139t fall:DTACK low:CS
+
+    lists every acknowledge of a bus cycle. Lines are CS, RW, RES, IRQ,
+    DTACK, DT, 12M, 16M, RX and TX.
+
+***************************************************************************/
+
+#include "c139trace.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+using namespace c139trace;
+
+bool open_reader(trace_reader &reader, const char *path)
+{
+	if (reader.open(path))
+		return true;
+	std::fprintf(stderr, "c139trace: %s is not a trace file\n", path);
+	return false;
+}
+
+void print_row(trace_reader &reader, uint64_t index, bool with_index = true)
+{
+	row r;
+	if (!reader.read(index, r))
+		return;
+	if (with_index)
+		std::printf("%10" PRIu64 "  %s\n", index, format_cycle_line(r).c_str());
+	else
+		std::printf("%s\n", format_cycle_line(r).c_str());
+}
+
+bool parse_condition(const char *text, condition &result)
+{
+	static const struct { const char *name; condition::kind what; } KINDS[] = {
+			{ "high:", condition::HIGH }, { "low:", condition::LOW },
+			{ "rise:", condition::RISE }, { "fall:", condition::FALL } };
+
+	for (auto const &k : KINDS)
+	{
+		size_t const length = std::strlen(k.name);
+		if (std::strncmp(text, k.name, length))
+			continue;
+		for (unsigned l = 0; l < LINE_COUNT; l++)
+		{
+			if (!std::strcmp(text + length, LINE_NAMES[l]))
+			{
+				result.line = l;
+				result.what = k.what;
+				return true;
+			}
+		}
+	}
+	std::fprintf(stderr, "c139trace: bad condition '%s'\n", text);
+	return false;
+}
+
+
+//-------------------------------------------------
+//  commands
+//-------------------------------------------------
+
+int pack(const char *input, const char *output)
+{
+	std::ifstream file(input);
+	if (!file)
+	{
+		std::fprintf(stderr, "c139trace: cannot open %s\n", input);
+		return 2;
+	}
+
+	trace_writer writer;
+	if (!writer.open(output))
+	{
+		std::fprintf(stderr, "c139trace: cannot create %s\n", output);
+		return 2;
+	}
+
+	std::string line;
+	uint64_t skipped = 0;
+	while (std::getline(file, line))
+	{
+		row r;
+		if (parse_cycle_line(line.c_str(), r))
+			writer.append(r);
+		else
+			skipped++;
+	}
+
+	uint64_t const rows = writer.rows();
+	if (!writer.close())
+	{
+		std::fprintf(stderr, "c139trace: error writing %s\n", output);
+		return 2;
+	}
+	std::printf("%" PRIu64 " cycles packed, %" PRIu64 " other lines skipped\n", rows, skipped);
+	return 0;
+}
+
+int info(const char *path)
+{
+	trace_reader reader;
+	if (!open_reader(reader, path))
+		return 2;
+
+	std::printf("%" PRIu64 " rows in %zu blocks\n", reader.rows(), reader.blocks());
+	row first, last;
+	if (reader.read(0, first) && reader.read(reader.rows() - 1, last))
+	{
+		std::printf("16MHz count %" PRIu64 " to %" PRIu64 "\n", first.count16, last.count16);
+		std::printf("12MHz count %" PRIu64 " to %" PRIu64 "\n", first.count12, last.count12);
+	}
+	return 0;
+}
+
+int dump(const char *path, uint64_t first, uint64_t count, bool raw)
+{
+	trace_reader reader;
+	if (!open_reader(reader, path))
+		return 2;
+
+	for (uint64_t index = first; index < reader.rows() && index - first < count; index++)
+		print_row(reader, index, !raw);
+	return 0;
+}
+
+int seek(const char *path, const char *clock, uint64_t count)
+{
+	bool const count16 = !std::strcmp(clock, "16m");
+	if (!count16 && std::strcmp(clock, "12m"))
+	{
+		std::fprintf(stderr, "c139trace: clock is 12m or 16m, not '%s'\n", clock);
+		return 2;
+	}
+
+	trace_reader reader;
+	if (!open_reader(reader, path))
+		return 2;
+
+	uint64_t const index = reader.seek_count(count, count16);
+	if (index >= reader.rows())
+	{
+		std::printf("not reached\n");
+		return 0;
+	}
+	print_row(reader, index);
+	return 0;
+}
+
+int find(const char *path, const std::vector<condition> &conditions, uint64_t max)
+{
+	trace_reader reader;
+	if (!open_reader(reader, path))
+		return 2;
+
+	// collect first, printing decodes the other columns and evicts the block
+	std::vector<uint64_t> hits;
+	uint64_t total = 0;
+	reader.query(conditions, 0,
+			[&] (uint64_t index)
+			{
+				if (hits.size() < max)
+					hits.push_back(index);
+				total++;
+				return true;
+			});
+
+	for (uint64_t const index : hits)
+		print_row(reader, index);
+	std::printf("%" PRIu64 " matching rows\n", total);
+	return 0;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char *argv[])
+{
+	char const *const command = (argc > 1) ? argv[1] : "";
+
+	if (!std::strcmp(command, "pack") && argc == 4)
+		return pack(argv[2], argv[3]);
+
+	if (!std::strcmp(command, "info") && argc == 3)
+		return info(argv[2]);
+
+	if (!std::strcmp(command, "dump"))
+	{
+		bool const raw = (argc > 2) && !std::strcmp(argv[2], "-r");
+		int const arg = raw ? 3 : 2;
+		if (argc > arg && argc <= arg + 3)
+		{
+			uint64_t const first = (argc > arg + 1) ? std::strtoull(argv[arg + 1], nullptr, 0) : 0;
+			uint64_t const count = (argc > arg + 2) ? std::strtoull(argv[arg + 2], nullptr, 0) : ~uint64_t(0);
+			return dump(argv[arg], first, count, raw);
+		}
+	}
+
+	if (!std::strcmp(command, "seek") && argc == 5)
+		return seek(argv[2], argv[3], std::strtoull(argv[4], nullptr, 0));
+
+	if (!std::strcmp(command, "find"))
+	{
+		int arg = 2;
+		uint64_t max = ~uint64_t(0);
+		if (arg + 1 < argc && !std::strcmp(argv[arg], "-n"))
+		{
+			max = std::strtoull(argv[arg + 1], nullptr, 0);
+			arg += 2;
+		}
+		if (arg + 1 < argc)
+		{
+			std::vector<condition> conditions;
+			for (int i = arg + 1; i < argc; i++)
+			{
+				condition c;
+				if (!parse_condition(argv[i], c))
+					return 2;
+				conditions.push_back(c);
+			}
+			return find(argv[arg], conditions, max);
+		}
+	}
+
+	std::fprintf(stderr, "Usage: c139trace pack <log> <out.c139t>\n");
+	std::fprintf(stderr, "       c139trace info <trace.c139t>\n");
+	std::fprintf(stderr, "       c139trace dump [-r] <trace.c139t> [first [count]]\n");
+	std::fprintf(stderr, "       c139trace seek <trace.c139t> 12m|16m <count>\n");
+	std::fprintf(stderr, "       c139trace find [-n max] <trace.c139t> <cond>...\n");
+	return 2;
+}
@@ -0,0 +1,677 @@
+// license:BSD-3-Clause
+// copyright-holders:Ariane Fugmann
+/***************************************************************************
+
+    c139trace.h - columnar store for C139.ino bus cycle traces
+
+    With DEBUG_LOG on the sketch prints every half cycle as a text line:
+
+    CYCLE: 0005 0004 ADDR:0001 DATA:0009 CTRL:[ 16M 12M DT ACK INT RES RD CS ] AUX:[ RX TX ]
+
+    The store keeps the same rows in blocks of BLOCK_ROWS, column by column:
+
+    lines       one bitmap per line (pin levels as read from PINL/PINH,
+                so CS, DTACK and friends are low when asserted)
+    count16/12  clock counters unwrapped to 64 bits, as varint deltas
+    addr/data   runs of (value, length) as varints
+
+    A block index at the end holds the offset and first counters of every
+    block, so a reader can seek by row or by clock count without touching
+    the rest. Queries like "DTACK fell while CS was low" run on the line
+    bitmaps 64 rows at a time and never decode the other columns.
+
+    file layout (all values little endian)
+
+    header:
+        8 bytes     magic "C139TRC" + version byte
+        8 bytes     rows
+        8 bytes     offset of the block index
+
+    block:
+        4 bytes     rows in this block
+        4 * 4 bytes byte sizes of count16, count12, addr and data
+        LINE_COUNT bitmaps of (rows + 63) / 64 u64 words
+        the four varint columns
+
+    block index:
+        4 bytes     blocks
+        per block:  8 bytes offset, 8 bytes first count16, 8 bytes first count12
+
+***************************************************************************/
+#ifndef C139_TOOLS_C139TRACE_H
+#define C139_TOOLS_C139TRACE_H
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+namespace c139trace {
+
+// bit numbers in row::lines, PINL first as wired in the sketch
+enum line : unsigned
+{
+	LINE_CS = 0,
+	LINE_RW,
+	LINE_RES,
+	LINE_IRQ,
+	LINE_DTACK,
+	LINE_DT,
+	LINE_12MHZ,
+	LINE_16MHZ,
+	LINE_RX,
+	LINE_TX,
+
+	LINE_COUNT
+};
+
+inline const char *const LINE_NAMES[LINE_COUNT] = { "CS", "RW", "RES", "IRQ", "DTACK", "DT", "12M", "16M", "RX", "TX" };
+
+struct row
+{
+	uint64_t count16 = 0;
+	uint64_t count12 = 0;
+	uint16_t addr = 0;
+	uint16_t data = 0;
+	uint16_t lines = 0;     // bit n is line n, pin level
+};
+
+constexpr unsigned BLOCK_ROWS = 4096;
+constexpr unsigned BLOCK_WORDS = BLOCK_ROWS / 64;
+
+inline const char MAGIC[8] = { 'C', '1', '3', '9', 'T', 'R', 'C', 1 };
+
+
+//**************************************************************************
+//  TEXT LINES
+//**************************************************************************
+
+namespace detail {
+
+inline bool skip_literal(const char *&p, const char *literal)
+{
+	size_t const length = std::strlen(literal);
+	if (std::strncmp(p, literal, length))
+		return false;
+	p += length;
+	return true;
+}
+
+inline bool parse_hex(const char *&p, unsigned &value)
+{
+	while (*p == ' ')
+		p++;
+	char const *const start = p;
+	value = 0;
+	for ( ; std::isxdigit(uint8_t(*p)); p++)
+		value = (value << 4) | unsigned(std::isdigit(uint8_t(*p)) ? (*p - '0') : ((*p | 0x20) - 'a' + 10));
+	return p != start;
+}
+
+} // namespace detail
+
+// parses one CYCLE line, the counters keep their 16 bits
+inline bool parse_cycle_line(const char *text, row &result)
+{
+	// multi-million line logs, so no sscanf here
+	unsigned count16, count12, addr, data;
+	char const *p = text;
+	if (!detail::skip_literal(p, "CYCLE:") || !detail::parse_hex(p, count16) || !detail::parse_hex(p, count12) ||
+			!detail::skip_literal(p, " ADDR:") || !detail::parse_hex(p, addr) ||
+			!detail::skip_literal(p, " DATA:") || !detail::parse_hex(p, data) ||
+			!detail::skip_literal(p, " CTRL:["))
+		return false;
+
+	// CTRL names asserted lines, "--" or "---" otherwise; RD/WT is R/W
+	static const struct { const char *name; unsigned line; bool level; } FLAGS[] = {
+			{ "16M", LINE_16MHZ, true }, { "12M", LINE_12MHZ, true },
+			{ "DT", LINE_DT, false }, { "ACK", LINE_DTACK, false },
+			{ "INT", LINE_IRQ, false }, { "RES", LINE_RES, false },
+			{ "RD", LINE_RW, true }, { "CS", LINE_CS, false },
+			{ "RX", LINE_RX, true }, { "TX", LINE_TX, true } };
+
+	uint16_t lines = (1 << LINE_DT) | (1 << LINE_DTACK) | (1 << LINE_IRQ) | (1 << LINE_RES) | (1 << LINE_CS);
+	while (*p)
+	{
+		while (*p == ' ')
+			p++;
+		char const *const token = p;
+		while (*p && *p != ' ')
+			p++;
+		size_t const length = p - token;
+		if (length < 2 || token[0] == '-')
+			continue;
+
+		for (auto const &flag : FLAGS)
+		{
+			if (!std::strncmp(token, flag.name, length) && !flag.name[length])
+			{
+				if (flag.level)
+					lines |= 1 << flag.line;
+				else
+					lines &= ~(1 << flag.line);
+				break;
+			}
+		}
+	}
+
+	result.count16 = count16;
+	result.count12 = count12;
+	result.addr = addr;
+	result.data = data;
+	result.lines = lines;
+	return true;
+}
+
+// the line as the sketch prints it
+inline std::string format_cycle_line(const row &r)
+{
+	auto const bit = [&r] (unsigned line) { return (r.lines >> line) & 1; };
+	char buffer[128];
+	std::snprintf(buffer, sizeof(buffer), "CYCLE: %04X %04X ADDR:%04X DATA:%04X CTRL:[ %s%s%s%s%s%s%s%s] AUX:[ %s%s]",
+			unsigned(r.count16 & 0xffff), unsigned(r.count12 & 0xffff), r.addr, r.data,
+			bit(LINE_16MHZ) ? "16M " : "--- ",
+			bit(LINE_12MHZ) ? "12M " : "--- ",
+			bit(LINE_DT) ? "-- " : "DT ",
+			bit(LINE_DTACK) ? "--- " : "ACK ",
+			bit(LINE_IRQ) ? "--- " : "INT ",
+			bit(LINE_RES) ? "--- " : "RES ",
+			bit(LINE_RW) ? "RD " : "WT ",
+			bit(LINE_CS) ? "-- " : "CS ",
+			bit(LINE_RX) ? "RX " : "-- ",
+			bit(LINE_TX) ? "TX " : "-- ");
+	return buffer;
+}
+
+
+//**************************************************************************
+//  ENCODING HELPERS
+//**************************************************************************
+
+namespace detail {
+
+inline void put_varint(std::vector<uint8_t> &out, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(uint8_t(value) | 0x80);
+		value >>= 7;
+	}
+	out.push_back(uint8_t(value));
+}
+
+inline uint64_t get_varint(const uint8_t *&p, const uint8_t *end)
+{
+	uint64_t value = 0;
+	for (unsigned shift = 0; p < end && shift < 64; shift += 7)
+	{
+		uint8_t const byte = *p++;
+		value |= uint64_t(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			break;
+	}
+	return value;
+}
+
+inline void put_le(std::vector<uint8_t> &out, uint64_t value, unsigned bytes)
+{
+	for (unsigned i = 0; i < bytes; i++)
+		out.push_back(uint8_t(value >> (i * 8)));
+}
+
+inline uint64_t get_le(const uint8_t *p, unsigned bytes)
+{
+	uint64_t value = 0;
+	for (unsigned i = 0; i < bytes; i++)
+		value |= uint64_t(p[i]) << (i * 8);
+	return value;
+}
+
+// runs of equal values as (value, length) pairs
+class rle_encoder
+{
+public:
+	void add(uint16_t value)
+	{
+		if (m_run && value == m_value)
+		{
+			m_run++;
+			return;
+		}
+		flush();
+		m_value = value;
+		m_run = 1;
+	}
+
+	void flush()
+	{
+		if (!m_run)
+			return;
+		put_varint(m_out, m_value);
+		put_varint(m_out, m_run);
+		m_run = 0;
+	}
+
+	std::vector<uint8_t> &out() { return m_out; }
+
+private:
+	std::vector<uint8_t> m_out;
+	uint16_t m_value = 0;
+	uint64_t m_run = 0;
+};
+
+inline void rle_decode(const uint8_t *p, const uint8_t *end, std::vector<uint16_t> &out, size_t rows)
+{
+	out.clear();
+	while (p < end && out.size() < rows)
+	{
+		uint16_t const value = uint16_t(get_varint(p, end));
+		uint64_t const run = get_varint(p, end);
+		out.insert(out.end(), std::min<uint64_t>(run, rows - out.size()), value);
+	}
+	out.resize(rows, 0);
+}
+
+} // namespace detail
+
+
+//**************************************************************************
+//  WRITER
+//**************************************************************************
+
+class trace_writer
+{
+public:
+	~trace_writer() { close(); }
+
+	bool open(const char *path)
+	{
+		m_file.open(path, std::ios::binary | std::ios::trunc);
+		if (!m_file)
+			return false;
+
+		// rows and index offset are patched in by close()
+		std::vector<uint8_t> header(MAGIC, MAGIC + sizeof(MAGIC));
+		detail::put_le(header, 0, 8);
+		detail::put_le(header, 0, 8);
+		write(header);
+		m_offset = header.size();
+		return true;
+	}
+
+	// counters are taken modulo 16 bits and unwrapped here
+	void append(const row &r)
+	{
+		if (!m_rows)
+		{
+			m_count16 = r.count16;
+			m_count12 = r.count12;
+		}
+		else
+		{
+			m_count16 += uint16_t(r.count16 - m_last16);
+			m_count12 += uint16_t(r.count12 - m_last12);
+		}
+		m_last16 = r.count16;
+		m_last12 = r.count12;
+
+		if (m_block_rows == 0)
+		{
+			m_index.push_back(index_entry{ m_offset, m_count16, m_count12 });
+			m_prev16 = m_count16;
+			m_prev12 = m_count12;
+			std::fill(std::begin(m_planes), std::end(m_planes), 0);
+		}
+
+		detail::put_varint(m_col16, m_count16 - m_prev16);
+		detail::put_varint(m_col12, m_count12 - m_prev12);
+		m_prev16 = m_count16;
+		m_prev12 = m_count12;
+		m_addr.add(r.addr);
+		m_data.add(r.data);
+
+		unsigned const word = m_block_rows / 64;
+		unsigned const bit = m_block_rows % 64;
+		for (unsigned l = 0; l < LINE_COUNT; l++)
+			m_planes[(l * BLOCK_WORDS) + word] |= uint64_t((r.lines >> l) & 1) << bit;
+
+		m_rows++;
+		if (++m_block_rows == BLOCK_ROWS)
+			flush_block();
+	}
+
+	bool close()
+	{
+		if (!m_file.is_open())
+			return true;
+		flush_block();
+
+		std::vector<uint8_t> index;
+		detail::put_le(index, m_index.size(), 4);
+		for (index_entry const &entry : m_index)
+		{
+			detail::put_le(index, entry.offset, 8);
+			detail::put_le(index, entry.count16, 8);
+			detail::put_le(index, entry.count12, 8);
+		}
+		write(index);
+
+		std::vector<uint8_t> patch;
+		detail::put_le(patch, m_rows, 8);
+		detail::put_le(patch, m_offset, 8);
+		m_file.seekp(sizeof(MAGIC));
+		write(patch);
+
+		bool const ok = bool(m_file);
+		m_file.close();
+		return ok;
+	}
+
+	uint64_t rows() const { return m_rows; }
+
+private:
+	struct index_entry
+	{
+		uint64_t offset;
+		uint64_t count16;
+		uint64_t count12;
+	};
+
+	void write(const std::vector<uint8_t> &bytes)
+	{
+		m_file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+	}
+
+	void flush_block()
+	{
+		if (!m_block_rows)
+			return;
+		m_addr.flush();
+		m_data.flush();
+
+		std::vector<uint8_t> block;
+		detail::put_le(block, m_block_rows, 4);
+		detail::put_le(block, m_col16.size(), 4);
+		detail::put_le(block, m_col12.size(), 4);
+		detail::put_le(block, m_addr.out().size(), 4);
+		detail::put_le(block, m_data.out().size(), 4);
+
+		unsigned const words = (m_block_rows + 63) / 64;
+		for (unsigned l = 0; l < LINE_COUNT; l++)
+			for (unsigned w = 0; w < words; w++)
+				detail::put_le(block, m_planes[(l * BLOCK_WORDS) + w], 8);
+
+		block.insert(block.end(), m_col16.begin(), m_col16.end());
+		block.insert(block.end(), m_col12.begin(), m_col12.end());
+		block.insert(block.end(), m_addr.out().begin(), m_addr.out().end());
+		block.insert(block.end(), m_data.out().begin(), m_data.out().end());
+		write(block);
+		m_offset += block.size();
+
+		m_col16.clear();
+		m_col12.clear();
+		m_addr.out().clear();
+		m_data.out().clear();
+		m_block_rows = 0;
+	}
+
+	std::ofstream m_file;
+	uint64_t m_offset = 0;
+	uint64_t m_rows = 0;
+	std::vector<index_entry> m_index;
+
+	uint64_t m_last16 = 0, m_last12 = 0;        // as read, 16 bits
+	uint64_t m_count16 = 0, m_count12 = 0;      // unwrapped
+	uint64_t m_prev16 = 0, m_prev12 = 0;
+
+	unsigned m_block_rows = 0;
+	uint64_t m_planes[LINE_COUNT * BLOCK_WORDS] = { };
+	std::vector<uint8_t> m_col16, m_col12;
+	detail::rle_encoder m_addr, m_data;
+};
+
+
+//**************************************************************************
+//  READER
+//**************************************************************************
+
+// one condition of a query, all of them have to hold on the same row
+struct condition
+{
+	enum kind { HIGH, LOW, RISE, FALL };
+
+	unsigned line;
+	kind what;
+};
+
+class trace_reader
+{
+public:
+	bool open(const char *path)
+	{
+		m_file.open(path, std::ios::binary);
+		uint8_t header[sizeof(MAGIC) + 16];
+		if (!m_file.read(reinterpret_cast<char *>(header), sizeof(header)) || std::memcmp(header, MAGIC, sizeof(MAGIC)))
+			return false;
+		m_rows = detail::get_le(&header[sizeof(MAGIC)], 8);
+
+		m_file.seekg(detail::get_le(&header[sizeof(MAGIC) + 8], 8));
+		uint8_t count[4];
+		if (!m_file.read(reinterpret_cast<char *>(count), sizeof(count)))
+			return false;
+		std::vector<uint8_t> index(size_t(detail::get_le(count, 4)) * 24);
+		if (!m_file.read(reinterpret_cast<char *>(index.data()), index.size()))
+			return false;
+		for (size_t i = 0; i < index.size(); i += 24)
+			m_index.push_back(index_entry{ detail::get_le(&index[i], 8), detail::get_le(&index[i + 8], 8), detail::get_le(&index[i + 16], 8) });
+
+		m_cached = ~size_t(0);
+		return true;
+	}
+
+	uint64_t rows() const { return m_rows; }
+	size_t blocks() const { return m_index.size(); }
+
+	bool read(uint64_t index, row &result)
+	{
+		if (index >= m_rows || !load(size_t(index / BLOCK_ROWS), true))
+			return false;
+		unsigned const r = unsigned(index % BLOCK_ROWS);
+		result.count16 = m_block.count16[r];
+		result.count12 = m_block.count12[r];
+		result.addr = m_block.addr[r];
+		result.data = m_block.data[r];
+		result.lines = 0;
+		for (unsigned l = 0; l < LINE_COUNT; l++)
+			result.lines |= ((m_block.planes[(l * BLOCK_WORDS) + (r / 64)] >> (r % 64)) & 1) << l;
+		return true;
+	}
+
+	// first row whose 12MHz (or 16MHz) count is at least count, rows() if none
+	uint64_t seek_count(uint64_t count, bool count16 = false)
+	{
+		auto const first = [count16] (const index_entry &entry) { return count16 ? entry.count16 : entry.count12; };
+		auto const it = std::upper_bound(m_index.begin(), m_index.end(), count,
+				[&first] (uint64_t value, const index_entry &entry) { return value < first(entry); });
+		size_t block = (it == m_index.begin()) ? 0 : size_t(it - m_index.begin() - 1);
+
+		for ( ; block < m_index.size(); block++)
+		{
+			if (!load(block, true))
+				break;
+			std::vector<uint64_t> const &counts = count16 ? m_block.count16 : m_block.count12;
+			auto const row = std::lower_bound(counts.begin(), counts.end(), count);
+			if (row != counts.end())
+				return (uint64_t(block) * BLOCK_ROWS) + (row - counts.begin());
+		}
+		return m_rows;
+	}
+
+	// calls found with every matching row from first on until it returns false
+	void query(const std::vector<condition> &conditions, uint64_t first, const std::function<bool (uint64_t)> &found)
+	{
+		// the last row of the previous block decides edges on the first row
+		uint16_t carry = 0;
+		size_t block = size_t(first / BLOCK_ROWS);
+		if (block && block < m_index.size())
+		{
+			if (!load(block - 1, false))
+				return;
+			carry = last_lines();
+		}
+
+		for ( ; block < m_index.size(); block++)
+		{
+			uint64_t const base = uint64_t(block) * BLOCK_ROWS;
+			if (!load(block, false))
+				return;
+
+			unsigned const words = (m_block.rows + 63) / 64;
+			for (unsigned w = 0; w < words; w++)
+			{
+				uint64_t hits = ~uint64_t(0);
+				if (w == words - 1 && (m_block.rows % 64))
+					hits = ~(~uint64_t(0) << (m_block.rows % 64));
+
+				for (condition const &c : conditions)
+				{
+					uint64_t const level = m_block.planes[(c.line * BLOCK_WORDS) + w];
+					uint64_t prev_in = (w ? (m_block.planes[(c.line * BLOCK_WORDS) + w - 1] >> 63) : ((carry >> c.line) & 1));
+
+					// the very first row has no edge
+					if (!base && !w)
+						prev_in = level & 1;
+					uint64_t const prev = (level << 1) | prev_in;
+
+					switch (c.what)
+					{
+						case condition::HIGH:   hits &= level;          break;
+						case condition::LOW:    hits &= ~level;         break;
+						case condition::RISE:   hits &= level & ~prev;  break;
+						case condition::FALL:   hits &= ~level & prev;  break;
+					}
+				}
+
+				while (hits)
+				{
+					unsigned const bit = count_trailing_zeros(hits);
+					hits &= hits - 1;
+					uint64_t const index = base + (w * 64) + bit;
+					if (index >= first && !found(index))
+						return;
+				}
+			}
+			carry = last_lines();
+		}
+	}
+
+private:
+	struct index_entry
+	{
+		uint64_t offset;
+		uint64_t count16;
+		uint64_t count12;
+	};
+
+	struct decoded_block
+	{
+		unsigned rows = 0;
+		bool full = false;
+		uint64_t planes[LINE_COUNT * BLOCK_WORDS] = { };
+		std::vector<uint64_t> count16, count12;
+		std::vector<uint16_t> addr, data;
+	};
+
+	uint16_t last_lines() const
+	{
+		unsigned const r = m_block.rows - 1;
+		uint16_t lines = 0;
+		for (unsigned l = 0; l < LINE_COUNT; l++)
+			lines |= ((m_block.planes[(l * BLOCK_WORDS) + (r / 64)] >> (r % 64)) & 1) << l;
+		return lines;
+	}
+
+	// full also decodes counters, address and data, queries only need lines
+	bool load(size_t block, bool full)
+	{
+		if (block == m_cached && (m_block.full || !full))
+			return true;
+
+		uint8_t header[20];
+		m_file.clear();
+		m_file.seekg(m_index[block].offset);
+		if (!m_file.read(reinterpret_cast<char *>(header), sizeof(header)))
+			return false;
+		unsigned const rows = unsigned(detail::get_le(&header[0], 4));
+		size_t const sizes[4] = {
+				size_t(detail::get_le(&header[4], 4)), size_t(detail::get_le(&header[8], 4)),
+				size_t(detail::get_le(&header[12], 4)), size_t(detail::get_le(&header[16], 4)) };
+		unsigned const words = (rows + 63) / 64;
+
+		std::vector<uint8_t> &bytes = m_bytes;
+		bytes.resize(size_t(LINE_COUNT) * words * 8 + (full ? (sizes[0] + sizes[1] + sizes[2] + sizes[3]) : 0));
+		if (!m_file.read(reinterpret_cast<char *>(bytes.data()), bytes.size()))
+			return false;
+
+		m_cached = block;
+		m_block.rows = rows;
+		m_block.full = full;
+		std::fill(std::begin(m_block.planes), std::end(m_block.planes), 0);
+		for (unsigned l = 0; l < LINE_COUNT; l++)
+			for (unsigned w = 0; w < words; w++)
+				m_block.planes[(l * BLOCK_WORDS) + w] = detail::get_le(&bytes[((l * words) + w) * 8], 8);
+		if (!full)
+			return true;
+
+		uint8_t const *p = &bytes[size_t(LINE_COUNT) * words * 8];
+		auto const counter = [rows] (const uint8_t *p, const uint8_t *end, uint64_t value, std::vector<uint64_t> &out)
+		{
+			out.resize(rows);
+			for (unsigned r = 0; r < rows; r++)
+				out[r] = value += detail::get_varint(p, end);
+		};
+		counter(p, p + sizes[0], m_index[block].count16, m_block.count16);
+		p += sizes[0];
+		counter(p, p + sizes[1], m_index[block].count12, m_block.count12);
+		p += sizes[1];
+		detail::rle_decode(p, p + sizes[2], m_block.addr, rows);
+		p += sizes[2];
+		detail::rle_decode(p, p + sizes[3], m_block.data, rows);
+		return true;
+	}
+
+	static unsigned count_trailing_zeros(uint64_t value)
+	{
+#if defined(__GNUC__)
+		return __builtin_ctzll(value);
+#else
+		unsigned count = 0;
+		while (!(value & 1))
+		{
+			value >>= 1;
+			count++;
+		}
+		return count;
+#endif
+	}
+
+	std::ifstream m_file;
+	uint64_t m_rows = 0;
+	std::vector<index_entry> m_index;
+	size_t m_cached = ~size_t(0);
+	decoded_block m_block;
+	std::vector<uint8_t> m_bytes;
+};
+
+} // namespace c139trace
+
+#endif // C139_TOOLS_C139TRACE_H
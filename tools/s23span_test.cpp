@@ -0,0 +1,446 @@
+// license:BSD-3-Clause
+// copyright-holders:R. Belmont, Ryan Holtz, Phil Stroffolino, Olivier Galibert
+/***************************************************************************
+
+    s23span_test - check the System 23 scanline helpers
+
+    Usage: s23span_test [spans]
+
+    Runs scanlines across random textured planes through
+    namcos23_span::stepper. The exact mode has to sample the same texels
+    and shades as the per-pixel loop the renderer used before
+    (reference_span below). The subspan mode is compared against it too,
+    and its worst texel error is printed by how many texels a pixel
+    covers there, for two sets of planes:
+
+    scenery     facing the camera up to 78 degrees off the view axis
+    steep       78 to 89.4 degrees off, a wall or road running into the
+                distance
+
+    The error grows with the texels per pixel, so it is largest towards
+    the horizon. Where the texture is magnified it has to stay within
+    MAX_MAGNIFIED_ERROR texels.
+
+    Then every combination of colour stages in namcos23_span::shade_lanes
+    runs on random texels, shades, colours and pixels underneath, and has
+    to give exactly what the original per-pixel rgbaint_t code
+    (reference_pixel below) gives. Exit status is 0 when every check
+    passes.
+
+***************************************************************************/
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <utility>
+
+using u8 = uint8_t;
+using u32 = uint32_t;
+using s32 = int32_t;
+using s64 = int64_t;
+
+#include "../new_c139/namcos23_span.h"
+
+
+namespace {
+
+// subspan texel error allowed below one texel per pixel
+constexpr int MAX_MAGNIFIED_ERROR = 1;
+
+// texels per pixel the error is reported by, the last band is open
+constexpr float BANDS[] = { 1.0f, 2.0f, 4.0f, 8.0f, 16.0f };
+constexpr int BAND_COUNT = std::size(BANDS) + 1;
+
+struct span
+{
+	float start[4];
+	float dpdx[4];
+	int length;
+};
+
+struct span_set
+{
+	const char *name;
+	float min_facing, max_facing;   // cosine of the angle between the plane normal and the view axis
+};
+
+// texels a pixel covers at x, from the derivative of u and v
+int band(const span &s, int x)
+{
+	float const z = s.start[0] + s.dpdx[0] * x;
+	float const du = (s.dpdx[1] * z - (s.start[1] + s.dpdx[1] * x) * s.dpdx[0]) / (z * z);
+	float const dv = (s.dpdx[2] * z - (s.start[2] + s.dpdx[2] * x) * s.dpdx[0]) / (z * z);
+	float const texels = std::max(std::fabs(du), std::fabs(dv));
+	int b = 0;
+	while (b < BAND_COUNT - 1 && texels >= BANDS[b])
+		b++;
+	return b;
+}
+
+// the per-pixel loop render_scanline had before the stepper
+void reference_span(const span &s, int *tx, int *ty, int *shade)
+{
+	float z = s.start[0];
+	float u = s.start[1];
+	float v = s.start[2];
+	float i = s.start[3];
+	for (int x = 0; x < s.length; x++)
+	{
+		float ooz = 1.0f / z;
+		tx[x] = int(u * ooz);
+		ty[x] = int(v * ooz);
+		shade[x] = i * ooz;
+		z += s.dpdx[0];
+		u += s.dpdx[1];
+		v += s.dpdx[2];
+		i += s.dpdx[3];
+	}
+}
+
+void stepped_span(const span &s, bool subspans, int *tx, int *ty, int *shade)
+{
+	namcos23_span::stepper coords(s.start, s.dpdx, subspans);
+	for (int x = 0, length = 0; x < s.length; x += length)
+	{
+		length = std::min(namcos23_span::LANES, s.length - x);
+		coords.step(length, &tx[x], &ty[x], &shade[x]);
+	}
+}
+
+// a scanline across a textured plane, projected like render_project does
+bool random_span(std::mt19937 &rng, const span_set &set, span &s)
+{
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> depth(2.0f, 100.0f);
+	std::uniform_real_distribution<float> facing(set.min_facing, set.max_facing);
+	std::uniform_real_distribution<float> density(0.5f, 2.0f);
+
+	// plane through a point ahead, its normal at the given angle to the view axis
+	float const d = depth(rng);
+	float const nz = -facing(rng);
+	float nx = unit(rng), ny = unit(rng);
+	float const scale = std::sqrt((1.0f - nz * nz) / (nx * nx + ny * ny));
+	nx *= scale;
+	ny *= scale;
+
+	// texture axes in the plane, about density texels per pixel around the point
+	float e1[3] = { ny, -nx, 0.0f };
+	float const e1_length = std::sqrt(e1[0] * e1[0] + e1[1] * e1[1]);
+	e1[0] /= e1_length;
+	e1[1] /= e1_length;
+	float const e2[3] = { ny * e1[2] - nz * e1[1], nz * e1[0] - nx * e1[2], nx * e1[1] - ny * e1[0] };
+	float const texels = density(rng) * 768.0f / d;
+	float const u0 = float(rng() % 4096), v0 = float(rng() % 4096);
+	float const i0 = float(rng() % 64);
+
+	// values over z at the centre of pixel x on row y, false behind the camera
+	float const row = float(rng() % 480) + 0.5f;
+	auto const params = [&] (float x, float *p)
+	{
+		float const r[3] = { (x - 320.0f) / 768.0f, (240.0f - row) / 768.0f, 1.0f };
+		float const denom = nx * r[0] + ny * r[1] + nz * r[2];
+		if (denom >= 0.0f)
+			return false;
+		float const t = (nz * d) / denom;
+		if (t < 0.5f || t > 1000.0f)
+			return false;
+		float const w[3] = { t * r[0], t * r[1], t * r[2] - d };
+		float const u = u0 + texels * (w[0] * e1[0] + w[1] * e1[1] + w[2] * e1[2]);
+		float const v = v0 + texels * (w[0] * e2[0] + w[1] * e2[1] + w[2] * e2[2]);
+		float const ooz = 1.0f / t;
+		p[0] = ooz;
+		p[1] = u * ooz;
+		p[2] = v * ooz;
+		p[3] = (i0 + 16.0f * unit(rng)) * ooz;
+		return true;
+	};
+
+	s.length = 1 + int(rng() % 640);
+	float const x0 = float(rng() % (641 - s.length)) + 0.5f;
+	float end[4];
+	if (!params(x0, s.start) || !params(x0 + s.length, end))
+		return false;
+	for (int p = 0; p < 4; p++)
+		s.dpdx[p] = (end[p] - s.start[p]) / float(s.length);
+
+	// coordinates that wrap an int are no texture anyone draws
+	for (float const t : { s.start[1] / s.start[0], s.start[2] / s.start[0], end[1] / end[0], end[2] / end[0] })
+	{
+		if (std::fabs(t) > 1e6f)
+			return false;
+	}
+	return true;
+}
+
+
+// the parts of MAME's rgbaint_t the original loop used, one pixel at a time
+class reference_rgb
+{
+public:
+	reference_rgb(u32 rgba) : m_a((rgba >> 24) & 0xff), m_r((rgba >> 16) & 0xff), m_g((rgba >> 8) & 0xff), m_b(rgba & 0xff) { }
+	reference_rgb(s32 a, s32 r, s32 g, s32 b) : m_a(a), m_r(r), m_g(g), m_b(b) { }
+
+	void scale_imm_and_clamp(s32 scale)
+	{
+		m_a = clamp((m_a * scale) >> 8);
+		m_r = clamp((m_r * scale) >> 8);
+		m_g = clamp((m_g * scale) >> 8);
+		m_b = clamp((m_b * scale) >> 8);
+	}
+
+	void scale_and_clamp(const reference_rgb &scale)
+	{
+		m_a = clamp((m_a * scale.m_a) >> 8);
+		m_r = clamp((m_r * scale.m_r) >> 8);
+		m_g = clamp((m_g * scale.m_g) >> 8);
+		m_b = clamp((m_b * scale.m_b) >> 8);
+	}
+
+	void blend(const reference_rgb &other, u8 factor)
+	{
+		s32 const scale1 = s32(factor);
+		s32 const scale2 = 256 - scale1;
+		m_a = (m_a * scale1 + other.m_a * scale2) >> 8;
+		m_r = (m_r * scale1 + other.m_r * scale2) >> 8;
+		m_g = (m_g * scale1 + other.m_g * scale2) >> 8;
+		m_b = (m_b * scale1 + other.m_b * scale2) >> 8;
+	}
+
+	u32 to_rgba() const { return (u32(u8(m_a)) << 24) | (u32(u8(m_r)) << 16) | (u32(u8(m_g)) << 8) | u32(u8(m_b)); }
+
+private:
+	static s32 clamp(s32 value) { return std::clamp<s32>(value, 0, 255); }
+
+	s32 m_a, m_r, m_g, m_b;
+};
+
+// what the polygon asked for, in the render data's terms
+struct polygon_colours
+{
+	bool shade_enabled, pfade_enabled, blend_enabled, alpha_enabled;
+	u8 fadefactor, alpha, alpha_pen;
+	u8 poly[3], fade[3];
+};
+
+// the colour part of the original per-pixel loop
+u32 reference_pixel(const polygon_colours &pc, u32 tex_rgb, int shade, u8 pen, u32 under)
+{
+	int const fadefactor = 0xff - pc.fadefactor;
+	int const alphafactor = 0xff - pc.alpha;
+	reference_rgb rgb(tex_rgb);
+
+	if (pc.shade_enabled)
+		rgb.scale_imm_and_clamp(shade << 2);
+	if (pc.pfade_enabled)
+		rgb.scale_and_clamp(reference_rgb(0xff, pc.poly[0], pc.poly[1], pc.poly[2]));
+	if (fadefactor != 0xff)
+		rgb.blend(reference_rgb(0xff, pc.fade[0], pc.fade[1], pc.fade[2]), fadefactor);
+	if (alphafactor != 0xff && (pc.alpha_enabled || pen == pc.alpha_pen))
+		rgb.blend(reference_rgb(under), alphafactor);
+	if (pc.blend_enabled)
+		rgb.blend(reference_rgb(under), 0x80);
+
+	return rgb.to_rgba() & 0xffffff;
+}
+
+// shade_lanes for every combination of stages, indexed like the driver's scanline kernels
+constexpr int STAGE_SHADE = 1, STAGE_POLYFADE = 2, STAGE_FADE = 4, STAGE_BLEND = 8, STAGE_ALPHA = 16;
+constexpr int STAGE_COUNT = STAGE_ALPHA * 3;
+
+using lanes_func = void (*)(const namcos23_span::colour_state &, int, s32 *, s32 *, s32 *, const s32 *, const u8 *, const u32 *);
+
+template <int... Stages>
+constexpr std::array<lanes_func, sizeof...(Stages)> make_lanes_funcs(std::integer_sequence<int, Stages...>)
+{
+	return { &namcos23_span::shade_lanes<(Stages & STAGE_SHADE) != 0, (Stages & STAGE_POLYFADE) != 0, (Stages & STAGE_FADE) != 0, Stages / STAGE_ALPHA, (Stages & STAGE_BLEND) != 0>... };
+}
+
+constexpr std::array<lanes_func, STAGE_COUNT> LANES_FUNCS = make_lanes_funcs(std::make_integer_sequence<int, STAGE_COUNT>());
+
+// the stages namcos23_renderer::scanline_kernel_index picks for a polygon
+int stages(const polygon_colours &pc)
+{
+	int result = 0;
+	if (pc.shade_enabled)
+		result |= STAGE_SHADE;
+	if (pc.pfade_enabled)
+		result |= STAGE_POLYFADE;
+	if (pc.fadefactor != 0)
+		result |= STAGE_FADE;
+	if (pc.blend_enabled)
+		result |= STAGE_BLEND;
+	if (pc.alpha != 0)
+		result += STAGE_ALPHA * (pc.alpha_enabled ? 1 : 2);
+	return result;
+}
+
+// mostly random, with the values at the ends of each range showing up often
+u8 random_factor(std::mt19937 &rng)
+{
+	switch (rng() % 8)
+	{
+		case 0: return 0x00;
+		case 1: return 0xff;
+		case 2: return 0x80;
+		default: return u8(rng());
+	}
+}
+
+unsigned check_lanes(unsigned subspans)
+{
+	std::mt19937 rng(139);
+	uint64_t pixels = 0;
+	unsigned diffs[STAGE_COUNT] = { };
+	unsigned covered[STAGE_COUNT] = { };
+	for (unsigned n = 0; n < subspans; n++)
+	{
+		polygon_colours pc;
+		pc.shade_enabled = rng() & 1;
+		pc.pfade_enabled = rng() & 1;
+		pc.blend_enabled = rng() & 1;
+		pc.alpha_enabled = rng() & 1;
+		pc.fadefactor = (rng() & 1) ? 0 : random_factor(rng);
+		pc.alpha = (rng() & 1) ? 0 : random_factor(rng);
+		pc.alpha_pen = u8(rng() % 4);
+		for (int c = 0; c < 3; c++)
+		{
+			pc.poly[c] = random_factor(rng);
+			pc.fade[c] = random_factor(rng);
+		}
+
+		// set up like render_scanline does
+		namcos23_span::colour_state cs;
+		cs.poly_r = pc.poly[0];
+		cs.poly_g = pc.poly[1];
+		cs.poly_b = pc.poly[2];
+		cs.fade_r = pc.fade[0];
+		cs.fade_g = pc.fade[1];
+		cs.fade_b = pc.fade[2];
+		cs.fadefactor = 0xff - pc.fadefactor;
+		cs.alphafactor = 0xff - pc.alpha;
+		cs.alpha_pen = pc.alpha_pen;
+
+		int const length = 1 + int(rng() % namcos23_span::LANES);
+		u32 tex[namcos23_span::LANES], under[namcos23_span::LANES];
+		int texel_shade[namcos23_span::LANES];
+		s32 r[namcos23_span::LANES], g[namcos23_span::LANES], b[namcos23_span::LANES], shade[namcos23_span::LANES];
+		u8 pen[namcos23_span::LANES];
+		for (int x = 0; x < length; x++)
+		{
+			tex[x] = 0xff000000 | (u32(random_factor(rng)) << 16) | (u32(random_factor(rng)) << 8) | random_factor(rng);
+			under[x] = 0xff000000 | (u32(random_factor(rng)) << 16) | (u32(random_factor(rng)) << 8) | random_factor(rng);
+			texel_shade[x] = int(rng() % 160) - 32;     // i over z strays out of range near the edges
+			pen[x] = u8(rng() % 4);
+			r[x] = (tex[x] >> 16) & 0xff;
+			g[x] = (tex[x] >> 8) & 0xff;
+			b[x] = tex[x] & 0xff;
+			shade[x] = texel_shade[x] << 2;
+		}
+
+		int const stage = stages(pc);
+		LANES_FUNCS[stage](cs, length, r, g, b, shade, pen, under);
+		covered[stage]++;
+		for (int x = 0; x < length; x++)
+		{
+			u32 const lanes = (u32(r[x]) << 16) | (u32(g[x]) << 8) | u32(b[x]);
+			bool const in_range = r[x] >= 0 && r[x] <= 0xff && g[x] >= 0 && g[x] <= 0xff && b[x] >= 0 && b[x] <= 0xff;
+			if (!in_range || lanes != reference_pixel(pc, tex[x], texel_shade[x], pen[x], under[x]))
+				diffs[stage]++;
+		}
+		pixels += length;
+	}
+
+	unsigned failures = 0;
+	for (int stage = 0; stage < STAGE_COUNT; stage++)
+	{
+		if (diffs[stage] || !covered[stage])
+		{
+			std::printf("FAIL colour stages %02x: %u differences in %u subspans\n", stage, diffs[stage], covered[stage]);
+			failures++;
+		}
+	}
+	std::printf("colour: %" PRIu64 " pixels through %d stage combinations, %u failing\n", pixels, STAGE_COUNT, failures);
+	return failures;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char *argv[])
+{
+	unsigned const spans = (argc > 1) ? unsigned(std::strtoul(argv[1], nullptr, 0)) : 20000;
+	static const span_set SETS[] = {
+		{ "scenery", 0.2f, 1.0f },
+		{ "steep", 0.01f, 0.2f }
+	};
+
+	int failures = 0;
+	std::mt19937 rng(23);
+	for (span_set const &set : SETS)
+	{
+		uint64_t pixels = 0, exact_diffs = 0;
+		uint64_t band_pixels[BAND_COUNT] = { }, band_moved[BAND_COUNT] = { };
+		int band_error[BAND_COUNT] = { };
+		int max_shade = 0;
+		for (unsigned n = 0; n < spans; n++)
+		{
+			span s;
+			if (!random_span(rng, set, s))
+				continue;
+			int ref_tx[640], ref_ty[640], ref_shade[640];
+			int tx[640], ty[640], shade[640];
+			reference_span(s, ref_tx, ref_ty, ref_shade);
+
+			stepped_span(s, false, tx, ty, shade);
+			for (int x = 0; x < s.length; x++)
+				exact_diffs += (tx[x] != ref_tx[x] || ty[x] != ref_ty[x] || shade[x] != ref_shade[x]) ? 1 : 0;
+
+			stepped_span(s, true, tx, ty, shade);
+			for (int x = 0; x < s.length; x++)
+			{
+				int const texel = std::max(std::abs(tx[x] - ref_tx[x]), std::abs(ty[x] - ref_ty[x]));
+				int const b = band(s, x);
+				band_pixels[b]++;
+				band_moved[b] += texel ? 1 : 0;
+				band_error[b] = std::max(band_error[b], texel);
+				max_shade = std::max(max_shade, std::abs(shade[x] - ref_shade[x]));
+			}
+			pixels += s.length;
+		}
+
+		std::printf("%s: %" PRIu64 " pixels, exact mode %" PRIu64 " differences, subspan shade off by up to %d\n",
+				set.name, pixels, exact_diffs, max_shade);
+		for (int b = 0; b < BAND_COUNT; b++)
+		{
+			char label[32];
+			if (b == 0)
+				std::snprintf(label, sizeof(label), "below %.0f", BANDS[b]);
+			else if (b < BAND_COUNT - 1)
+				std::snprintf(label, sizeof(label), "%.0f to %.0f", BANDS[b - 1], BANDS[b]);
+			else
+				std::snprintf(label, sizeof(label), "%.0f and more", BANDS[b - 1]);
+			std::printf("  %-12s texels/pixel: %9" PRIu64 " pixels, %6.2f%% moved, subspan error up to %d texel(s)\n",
+					label, band_pixels[b], band_pixels[b] ? 100.0 * double(band_moved[b]) / double(band_pixels[b]) : 0.0, band_error[b]);
+		}
+		if (exact_diffs)
+		{
+			std::printf("FAIL %s: the exact mode doesn't match the per-pixel loop\n", set.name);
+			failures++;
+		}
+		if (band_error[0] > MAX_MAGNIFIED_ERROR)
+		{
+			std::printf("FAIL %s: magnified subspan error %d texels, at most %d expected\n", set.name, band_error[0], MAX_MAGNIFIED_ERROR);
+			failures++;
+		}
+	}
+
+	failures += check_lanes(spans * 10);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+#!/bin/sh
+# license:BSD-3-Clause
+# copyright-holders:R. Belmont, Ryan Holtz, Phil Stroffolino, Olivier Galibert
+#
+# s23span_test.sh - check the System 23 scanline helpers
+#
+# Builds s23span_test against new_c139/namcos23_span.h and runs it, see
+# the top of s23span_test.cpp for what it checks and prints.
+#
+# Usage: tools/s23span_test.sh [work dir]
+#
+# CXX selects the compiler (default c++). Exit status is 0 when every
+# check passes.
+
+set -u
+
+TOOLS=$(cd "$(dirname "$0")" && pwd)
+WORK=${1:-$(mktemp -d)}
+CXX=${CXX:-c++}
+
+mkdir -p "$WORK" || exit 2
+"$CXX" -std=c++17 -O2 -o "$WORK/s23span_test" "$TOOLS/s23span_test.cpp" || exit 2
+"$WORK/s23span_test"